@@ -0,0 +1,146 @@
+#include "Acceptor.h"
+#include "WorkerPool.h"
+#include "RequestDispatcher.h"
+#include "NetworkUtils.h"
+#include "ServerStats.h"
+#include <QTcpSocket>
+#include <QTimer>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+Acceptor::Acceptor(int index, const ServerConfig &config, WorkerPool *workerPool, QObject *parent)
+    : QTcpServer(parent), m_index(index), m_config(config), m_workerPool(workerPool) {}
+
+bool Acceptor::reusePortSupported()
+{
+#if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Acceptor::listenOn(quint16 port, bool reusePort)
+{
+    if (reusePort)
+        return listenReusePort(port);
+
+    if (!listen(QHostAddress::Any, port)) {
+        qCritical() << "监听失败：" << errorString();
+        return false;
+    }
+    return true;
+}
+
+bool Acceptor::listenReusePort(quint16 port)
+{
+#if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+    // QTcpServer 不能设置 SO_REUSEPORT，自行创建监听套接字后交给它
+    // 优先双栈 IPv6，与 QHostAddress::Any 一致；不支持时退回 IPv4
+    int fd = ::socket(AF_INET6, SOCK_STREAM, 0);
+    bool ipv6 = fd >= 0;
+    if (!ipv6)
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        qCritical() << "创建监听套接字失败：" << strerror(errno);
+        return false;
+    }
+
+    const int on = 1;
+    const int off = 0;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+        qCritical() << "设置 SO_REUSEPORT 失败：" << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    int rc;
+    if (ipv6) {
+        ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        sockaddr_in6 addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(port);
+        rc = ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    } else {
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        rc = ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+
+    if (rc != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        qCritical() << "绑定端口失败：" << port << strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    if (!setSocketDescriptor(fd)) {
+        qCritical() << "接管监听套接字失败：" << errorString();
+        ::close(fd);
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(port);
+    qCritical() << "当前平台不支持 SO_REUSEPORT";
+    return false;
+#endif
+}
+
+void Acceptor::incomingConnection(qintptr socketDescriptor)
+{
+    qInfo() << "新客户端连接：" << socketDescriptor << "接收线程：" << m_index;
+
+    // 连接数已满时立即回复 server_busy，不让它排队拖慢其它连接
+    ServerStats &stats = ServerStats::instance();
+    const qint64 active = stats.connectionsActive.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (m_config.maxConnections > 0 && active > m_config.maxConnections) {
+        stats.connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+        stats.connectionsRejected.fetch_add(1, std::memory_order_relaxed);
+        rejectConnection(socketDescriptor);
+        return;
+    }
+
+    // 交给负载最轻的 I/O 工作线程，由其事件循环驱动该连接；交不出去时撤回计数并关闭
+    if (!m_workerPool->dispatch(socketDescriptor)) {
+        stats.connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+        QTcpSocket socket;
+        if (socket.setSocketDescriptor(socketDescriptor))
+            socket.abort();
+        return;
+    }
+    stats.connectionsAccepted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Acceptor::rejectConnection(qintptr socketDescriptor)
+{
+    // 拒绝连接时回复完 server_busy 就断开，客户端不读时宽限期后强制关闭
+    static constexpr int kRejectGraceMs = 2000;
+
+    QTcpSocket *socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return;
+    }
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+
+    NetworkUtils::sendJson(socket, RequestDispatcher::serverBusyReply("connections", m_config.busyRetryAfterMs));
+    socket->disconnectFromHost();
+    QTimer::singleShot(kRejectGraceMs, socket, [socket]() {
+        socket->abort();
+        socket->deleteLater();
+    });
+    qWarning() << "连接数已达上限" << m_config.maxConnections << "，拒绝连接：" << socketDescriptor;
+}
@@ -0,0 +1,34 @@
+#ifndef ACCEPTOR_H
+#define ACCEPTOR_H
+
+#include <QTcpServer>
+#include "ServerConfig.h"
+
+class WorkerPool;
+
+// 监听套接字的持有者：接受连接、做连接数准入，然后直接交给 I/O 工作线程
+// 开启 SO_REUSEPORT 时同一端口上有多个 Acceptor，各自运行在独立线程，由内核分摊新连接
+class Acceptor : public QTcpServer
+{
+    Q_OBJECT
+public:
+    explicit Acceptor(int index, const ServerConfig &config, WorkerPool *workerPool, QObject *parent = nullptr);
+
+    // 必须在 Acceptor 所属线程中调用
+    bool listenOn(quint16 port, bool reusePort);
+
+    static bool reusePortSupported();
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    bool listenReusePort(quint16 port);
+    void rejectConnection(qintptr socketDescriptor);
+
+    int m_index;
+    ServerConfig m_config;
+    WorkerPool *m_workerPool;
+};
+
+#endif // ACCEPTOR_H
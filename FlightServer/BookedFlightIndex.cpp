@@ -0,0 +1,80 @@
+#include "BookedFlightIndex.h"
+#include "ServerStats.h"
+#include <QMutexLocker>
+
+BookedFlightIndex::BookedFlightIndex(int maxUsers)
+    : m_users(qMax(1, maxUsers))
+{
+}
+
+bool BookedFlightIndex::lookup(const QString &username, QSet<int> &flights)
+{
+    ServerStats &stats = ServerStats::instance();
+    QMutexLocker locker(&m_mutex);
+    Entry *entry = m_users.object(username);
+    if (entry && entry->loaded) {
+        flights = flightsOf(*entry);
+        stats.bookedIndexHits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (!entry) {
+        m_users.insert(username, new Entry);
+        stats.bookedIndexUsers.store(m_users.size(), std::memory_order_relaxed);
+    }
+    stats.bookedIndexLoads.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void BookedFlightIndex::finishLoad(const QString &username, const QHash<QString, int> &orders,
+                                   QSet<int> &flights)
+{
+    QMutexLocker locker(&m_mutex);
+    Entry *entry = m_users.object(username);
+    if (!entry) {
+        // 载入期间被挤出缓存，这次结果只用于本次回复
+        Entry loaded;
+        loaded.orders = orders;
+        flights = flightsOf(loaded);
+        return;
+    }
+
+    if (!entry->loaded) {
+        // 先放数据库结果，再重放载入期间的变化
+        QHash<QString, int> merged = orders;
+        for (auto it = entry->orders.constBegin(); it != entry->orders.constEnd(); ++it)
+            merged.insert(it.key(), it.value());
+        for (const QString &orderNum : std::as_const(entry->removed))
+            merged.remove(orderNum);
+        entry->orders = std::move(merged);
+        entry->removed.clear();
+        entry->loaded = true;
+    }
+    flights = flightsOf(*entry);
+}
+
+void BookedFlightIndex::addOrder(const QString &username, const QString &orderNum, int flightId)
+{
+    QMutexLocker locker(&m_mutex);
+    if (Entry *entry = m_users.object(username))
+        entry->orders.insert(orderNum, flightId);
+}
+
+void BookedFlightIndex::removeOrder(const QString &username, const QString &orderNum)
+{
+    QMutexLocker locker(&m_mutex);
+    if (Entry *entry = m_users.object(username)) {
+        entry->orders.remove(orderNum);
+        if (!entry->loaded)
+            entry->removed.insert(orderNum);
+    }
+}
+
+QSet<int> BookedFlightIndex::flightsOf(const Entry &entry)
+{
+    QSet<int> flights;
+    flights.reserve(entry.orders.size());
+    for (int flightId : entry.orders)
+        flights.insert(flightId);
+    return flights;
+}
@@ -0,0 +1,42 @@
+#ifndef BOOKEDFLIGHTINDEX_H
+#define BOOKEDFLIGHTINDEX_H
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QCache>
+#include <QMutex>
+
+// 每个用户有效订单（待出行、已完成）涉及的航班，用于航班列表中的 isBooked。
+// 用户第一次查询时从 orders 载入，之后由订票、退票直接维护，不再查库。
+// 按订单号记录，载入期间发生的订退票在载入完成后重放，重复应用也不会出错
+class BookedFlightIndex
+{
+public:
+    explicit BookedFlightIndex(int maxUsers = 10000);
+
+    // 已载入时填充 flights 并返回 true；否则登记为载入中并返回 false，
+    // 调用方查询数据库后调用 finishLoad
+    bool lookup(const QString &username, QSet<int> &flights);
+
+    // orders 为 订单号 -> 航班 id；flights 返回合并载入期间变化后的结果
+    void finishLoad(const QString &username, const QHash<QString, int> &orders, QSet<int> &flights);
+
+    // 订单生效、退票；用户未缓存时忽略
+    void addOrder(const QString &username, const QString &orderNum, int flightId);
+    void removeOrder(const QString &username, const QString &orderNum);
+
+private:
+    struct Entry {
+        QHash<QString, int> orders;
+        QSet<QString> removed;  // 载入期间退掉的订单
+        bool loaded = false;
+    };
+
+    static QSet<int> flightsOf(const Entry &entry);
+
+    QMutex m_mutex;
+    QCache<QString, Entry> m_users;
+};
+
+#endif // BOOKEDFLIGHTINDEX_H
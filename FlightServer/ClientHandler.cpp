@@ -1,348 +1,300 @@
 #include "ClientHandler.h"
+#include "LogCategories.h"
 #include "NetworkUtils.h"
+#include "ServerStats.h"
 #include <QJsonDocument>
 #include <QDebug>
 
-ClientHandler::ClientHandler(qintptr socketDescriptor, DbHandler *dbHandler, QObject *parent)
-    : QThread(parent), m_socketDescriptor(socketDescriptor), m_dbHandler(dbHandler), m_socket(nullptr) {}
+// Qt 内部读缓冲上限，超过后停止从内核读取
+static constexpr qint64 kSocketReadBufferSize = 64 * 1024;
+
+ClientHandler::ClientHandler(qintptr socketDescriptor, const ServerConfig &config,
+                             RequestDispatcher *dispatcher, TimerWheel *timerWheel,
+                             FlightSubscriptions *subscriptions, QObject *parent)
+    : QObject(parent), m_socketDescriptor(socketDescriptor), m_config(config), m_socket(nullptr),
+      m_writer(nullptr), m_dispatcher(dispatcher), m_decoder(config.maxFrameSize),
+      m_timeouts(config, timerWheel), m_subscriptions(subscriptions) {}
 
 ClientHandler::~ClientHandler()
 {
-    if (m_socket) {
+    // 取消后数据库线程不会再向本对象投递分块
+    for (const std::shared_ptr<ReplyStream> &stream : std::as_const(m_streams))
+        stream->cancel();
+    if (m_subscriberId)
+        m_subscriptions->removeSubscriber(m_subscriberId);
+    if (m_socket)
         m_socket->abort();
-        m_socket->deleteLater();
-    }
 }
 
-void ClientHandler::run()
+bool ClientHandler::start()
 {
-    m_socket = new QTcpSocket();
+    // 套接字作为子对象，与处理器同属工作线程并随其一起释放
+    m_socket = new QTcpSocket(this);
     if (!m_socket->setSocketDescriptor(m_socketDescriptor)) {
         qWarning() << "Socket初始化失败：" << m_socket->errorString();
-        return;
+        return false;
     }
 
-    connect(m_socket, &QTcpSocket::readyRead, this, &ClientHandler::onReadyRead, Qt::DirectConnection);
-    connect(m_socket, &QTcpSocket::disconnected, this, &ClientHandler::onDisconnected, Qt::DirectConnection);
+    // 回复已按事件循环批量写出，关闭 Nagle 避免小包被额外延迟
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    if (m_config.socketSendBufferSize > 0)
+        m_socket->setSocketOption(QAbstractSocket::SendBufferSizeSocketOption, m_config.socketSendBufferSize);
+    if (m_config.socketReceiveBufferSize > 0)
+        m_socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, m_config.socketReceiveBufferSize);
 
-    exec();
-}
+    // 限制 Qt 内部读缓冲，暂停读取时由 TCP 窗口向客户端施加反压
+    m_socket->setReadBufferSize(kSocketReadBufferSize);
 
-void ClientHandler::onReadyRead()
-{
-    QJsonObject json;
-    if (NetworkUtils::receiveJson(m_socket, json)) {
-        qDebug() << "收到前端请求：" << json;
-        processRequest(json);
-    }
-}
+    m_writer = new ReplyWriter(m_socket, this);
 
-void ClientHandler::onDisconnected()
-{
-    m_socket->close();
-    quit();
+    connect(m_socket, &QTcpSocket::readyRead, this, &ClientHandler::onReadyRead);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &ClientHandler::onBytesWritten);
+    connect(m_socket, &QTcpSocket::disconnected, this, &ClientHandler::onDisconnected);
+
+    m_timeouts.start([this]() { onTimer(); });
+    m_subscriberId = m_subscriptions->addSubscriber([this](const QJsonObject &frame) {
+        m_writer->send(frame, m_format);
+        checkBackpressure();
+    });
+    return true;
 }
 
-void ClientHandler::processRequest(const QJsonObject &request)
+void ClientHandler::onReadyRead()
 {
-    QString type = request["type"].toString();
-    QJsonObject data ;
-    QJsonObject resp;
-
-    // 检查请求结构：有些请求数据在data字段，有些直接在根级别
-    if (request.contains("data") && request["data"].isObject()) {
-        data = request["data"].toObject();
-    } else {
-        // 如果没有data字段，尝试从根级别获取相关字段
-        data = request;
-        // 移除type字段，避免混淆
-        data.remove("type");
-    }
+    m_timeouts.touch();
+
+    // 待发送数据过多时不再读取，数据留在套接字中
+    if (m_readPaused)
+        return;
 
-    qDebug() << "处理请求类型:" << type;
-    qDebug() << "最终使用的数据:" << data;
-
-    if (type == "login") {
-        resp = handleLogin(data);
-    }else if (type == "register") {
-        resp = handleRegister(data);
-    } else if (type == "check_phone") {
-        resp = handleCheckPhone(data);
-    } else if (type == "check_idcard") {
-        resp = handleCheckIdCard(data);
-    } else if (type == "get_user_info") {
-        resp = handleGetUserInfo(data);
-    } else if (type == "change_password") {
-        resp = handleChangePassword(data);
-    } else if (type == "get_flights") {
-        resp = handleGetFlights(data);
-    } else if (type == "book_flight") {
-        resp = handleBookFlight(data);
-    } else if (type == "get_user_orders") {
-        resp = handleGetOrders(data);
-    } else if (type == "refund_order") {
-        resp = handleRefundOrder(data);
-    } else if (type == "add_passenger") {
-        resp = handleAddPassenger(data);
-    } else if (type == "get_passengers") {
-        resp = handleGetPassengers(data);
-    } else if (type == "update_passenger") {
-        resp = handleUpdatePassenger(data);
-    } else if (type == "delete_passenger") {
-        resp = handleDeletePassenger(data);
-    }else {
-        resp["type"] = "error";
-        resp["success"] = false;
-        resp["message"] = "未知请求类型";
+    m_decoder.append(m_socket->readAll());
+
+    // 一次取完缓冲区中所有完整帧，客户端可以流水线发送请求
+    QByteArray payload;
+    while (!m_readPaused) {
+        FrameDecoder::Status status = m_decoder.next(payload);
+        if (status == FrameDecoder::NeedMore)
+            break;
+        if (status == FrameDecoder::FrameTooLarge) {
+            qWarning() << "数据帧超过上限" << m_decoder.maxFrameSize() << "字节，已丢弃";
+            QJsonObject resp;
+            resp["type"] = "error";
+            resp["success"] = false;
+            resp["message"] = "数据帧过大";
+            resp["max_frame_size"] = qint64(m_decoder.maxFrameSize());
+            m_writer->send(resp, m_format);
+            continue;
+        }
+        if (status == FrameDecoder::Malformed) {
+            qWarning() << "收到格式错误的数据帧";
+            continue;
+        }
+
+        QJsonObject json;
+        if (NetworkUtils::decodePayload(payload, m_format, json)) {
+            qCDebug(lcRequests) << "收到前端请求：" << json;
+            processRequest(json);
+            checkBackpressure();
+        }
     }
 
-    NetworkUtils::sendJson(m_socket, resp);
+    // 只在等待客户端补齐数据时计半包超时，因反压暂停时不计
+    m_timeouts.setPartialFrame(!m_readPaused && (m_decoder.bufferedBytes() > 0 || m_decoder.isSkipping()));
 }
 
-// ===== 业务处理方法 =====
-QJsonObject ClientHandler::handleLogin(const QJsonObject &data)
+void ClientHandler::onBytesWritten()
 {
-    QJsonObject resp;
-    resp["type"] = "login_reply";
-
-    QString phone = data["phone"].toString();
-    QString password = data["password"].toString();
-
-    QJsonObject dbResp = m_dbHandler->verifyUser(phone, password);
-    if (dbResp["code"].toInt() == 200) {
-        resp["success"] = true;
-        resp["data"] = dbResp["data"].toObject();
-        // 添加调试信息
-        qDebug() << "登录成功，返回前端的数据:" << resp["data"].toObject();
-    } else {
-        resp["success"] = false;
-        resp["message"] = dbResp["msg"].toString();
-    }
-    return resp;
+    releaseStalledStreams();
+    maybeResumeReading();
 }
 
-
-QJsonObject ClientHandler::handleRegister(const QJsonObject &data)
+void ClientHandler::maybeResumeReading()
 {
-    QJsonObject resp;
-    resp["type"] = "register_reply";
-
-    // nickname 对应 username，不需要 realname
-    QString username = data["nickname"].toString();  // nickname 作为 username
-    QString password = data["password"].toString();
-    QString phone = data["phone"].toString();
-    QString idCard = data["id_card"].toString();  // 可选的身份证号
-
-    QJsonObject dbResp = m_dbHandler->registerUser(username, password, phone, idCard);
-    if (dbResp["code"].toInt() == 200) {
-        resp["success"] = true;
-        resp["data"] = dbResp["data"].toObject();
-    } else {
-        resp["success"] = false;
-        resp["message"] = dbResp["msg"].toString();
+    if (m_readPaused && m_socket->state() == QAbstractSocket::ConnectedState
+        && pendingWriteBytes() <= m_config.writeLowWaterMark
+        && m_orderedRequests.size() < m_config.maxQueuedRequests) {
+        m_readPaused = false;
+        qDebug() << "待发送数据已降至低水位，恢复读取";
+        // 处理暂停期间留在解码器和套接字中的请求
+        onReadyRead();
     }
-    return resp;
 }
 
-QJsonObject ClientHandler::handleCheckPhone(const QJsonObject &data)
+qint64 ClientHandler::pendingWriteBytes() const
 {
-    QJsonObject resp;
-    resp["type"] = "check_phone_reply";
-
-    QString phone = data["phone"].toString();
-    QJsonObject dbResp = m_dbHandler->checkPhoneExists(phone);
-
-    if (dbResp["code"].toInt() == 200) {
-        resp["success"] = true;
-        resp["data"] = QJsonObject{
-            {"exists", dbResp["exists"].toBool()}
-        };
-    } else {
-        resp["success"] = false;
-        resp["message"] = dbResp["msg"].toString();
-    }
-    return resp;
+    return m_socket->bytesToWrite() + m_writer->pendingBytes();
 }
 
-QJsonObject ClientHandler::handleCheckIdCard(const QJsonObject &data)
+void ClientHandler::checkBackpressure()
 {
-    QJsonObject resp;
-    resp["type"] = "check_idcard_reply";
-
-    QString idCard = data["idCard"].toString();
-    QJsonObject dbResp = m_dbHandler->checkIdCardExists(idCard);
-
-    if (dbResp["code"].toInt() == 200) {
-        resp["success"] = true;
-        resp["data"] = QJsonObject{
-            {"exists", dbResp["exists"].toBool()}
-        };
-    } else {
-        resp["success"] = false;
-        resp["message"] = dbResp["msg"].toString();
+    const qint64 pending = pendingWriteBytes();
+    if (pending > m_config.maxPendingWriteBytes) {
+        qWarning() << "客户端读取过慢，待发送" << pending << "字节，断开连接";
+        m_readPaused = true;
+        m_socket->abort();
+        return;
+    }
+    if (!m_readPaused && pending > m_config.writeHighWaterMark) {
+        m_readPaused = true;
+        qDebug() << "待发送数据超过高水位" << pending << "字节，暂停读取";
+    }
+    if (!m_readPaused && m_orderedRequests.size() >= m_config.maxQueuedRequests) {
+        m_readPaused = true;
+        qDebug() << "排队请求达到" << m_orderedRequests.size() << "个，暂停读取";
     }
-    return resp;
 }
 
-QJsonObject ClientHandler::handleGetUserInfo(const QJsonObject &data)
+void ClientHandler::onDisconnected()
 {
-    QJsonObject resp;
-    resp["type"] = "get_user_info_reply";
-
-    QString username = data["user_id"].toString();
-    QJsonObject dbResp = m_dbHandler->getUserInfo(username);
-    if (dbResp["code"].toInt() == 200) {
-        resp["success"] = true;
-        resp["data"] = dbResp["data"].toObject();
-    } else {
-        resp["success"] = false;
-        resp["message"] = dbResp["msg"].toString();
-    }
-    return resp;
+    m_socket->close();
+    deleteLater();
 }
 
-QJsonObject ClientHandler::handleChangePassword(const QJsonObject &data)
+void ClientHandler::processRequest(const QJsonObject &request)
 {
-    QJsonObject resp;
-    resp["type"] = "change_password_reply";
-
-    QString username = data["user_id"].toString();
-    QString oldPwd = data["old_pwd"].toString();
-    QString newPwd = data["new_pwd"].toString();
+    // 编码协商与心跳属于连接状态，不交给分发器
+    QJsonObject reply;
+    NetworkUtils::WireFormat nextFormat;
+    if (NetworkUtils::handleControlMessage(request, m_format, reply, nextFormat)) {
+        // 回复仍使用旧编码，之后双方都切换到新编码
+        if (!reply.isEmpty())
+            m_writer->send(reply, m_format);
+        if (nextFormat != m_format) {
+            m_format = nextFormat;
+            qDebug() << "连接编码切换为：" << NetworkUtils::formatName(m_format);
+        }
+        return;
+    }
 
-    QJsonObject dbResp = m_dbHandler->changePassword(username, oldPwd, newPwd);
-    resp["success"] = (dbResp["code"].toInt() == 200);
-    resp["message"] = dbResp["msg"].toString();
-    return resp;
-}
+    // 航班订阅登记在本线程的订阅表中，同样不占用在途请求名额
+    if (m_subscriptions->handleRequest(m_subscriberId, request, reply)) {
+        m_writer->send(reply, m_format);
+        return;
+    }
 
-QJsonObject ClientHandler::handleGetFlights(const QJsonObject &data)
-{
-    QJsonObject resp;
-    resp["type"] = "get_flights_reply";
-
-    QString username = data["user_id"].toString();
-    QString from = data["from_city"].toString();
-    QString to = data["to_city"].toString();
-    QString date = data["date"].toString();
-
-    QJsonObject dbResp = m_dbHandler->getFlightList(username,from, to, date);
-    if (dbResp["code"].toInt() == 200) {
-        resp["success"] = true;
-        resp["data"] = dbResp["data"].toArray();
-    } else {
-        resp["success"] = false;
-        resp["message"] = dbResp["msg"].toString();
+    // 不带 req_id 的请求排队按到达顺序执行
+    const QJsonValue reqId = request.value("req_id");
+    if (reqId.isUndefined()) {
+        m_orderedRequests.enqueue(request);
+        runOrderedRequests();
+        return;
     }
-    return resp;
-}
 
-QJsonObject ClientHandler::handleBookFlight(const QJsonObject &data)
-{
-    QJsonObject resp;
-    resp["type"] = "book_flight_reply";
+    // 过载时直接拒绝，不让请求在线程池中排队
+    if (!m_dispatcher->tryBeginRequest()) {
+        QJsonObject resp = RequestDispatcher::serverBusyReply("requests", m_dispatcher->busyRetryAfterMs());
+        resp["req_id"] = reqId;
+        m_writer->send(resp, m_format);
+        return;
+    }
 
-    QString username = data["user_id"].toString();
-    QString flightNum = data["flight_number"].toString();
+    if (m_dispatcher->runsInline(request)) {
+        QJsonObject resp = m_dispatcher->dispatch(request);
+        m_dispatcher->endRequest();
+        resp["req_id"] = reqId;
+        m_writer->send(resp, m_format);
+        return;
+    }
 
-    QJsonObject dbResp = m_dbHandler->bookFlight(username, flightNum);
-    resp["success"] = (dbResp["code"].toInt() == 200);
-    resp["message"] = dbResp["msg"].toString();
-    return resp;
+    // 带 req_id 的请求在数据库线程池中并发执行，完成即回复（可能乱序）
+    std::shared_ptr<ReplyStream> stream;
+    if (m_dispatcher->wantsStream(request))
+        stream = openStream(reqId);
+    m_dispatcher->dispatchAsync(request, stream).then(this, [this, reqId, stream](Reply resp) {
+        if (stream)
+            closeStream(stream);
+        resp.json["req_id"] = reqId;
+        m_writer->send(resp, m_format);
+        checkBackpressure();
+    });
 }
 
-QJsonObject ClientHandler::handleGetOrders(const QJsonObject &data)
+void ClientHandler::runOrderedRequests()
 {
-    QJsonObject resp;
-    resp["type"] = "get_user_orders_reply";
-
-    QString username = data["user_id"].toString();
-    QJsonObject dbResp = m_dbHandler->getOrderListWithFlight(username);
-    if (dbResp["code"].toInt() == 200) {
-        resp["success"] = true;
-        resp["data"] = dbResp["data"].toArray();
-    } else {
-        resp["success"] = false;
-        resp["message"] = dbResp["msg"].toString();
+    while (!m_orderedRunning && !m_orderedRequests.isEmpty()) {
+        const QJsonObject request = m_orderedRequests.dequeue();
+
+        // 名额在开始执行时才占用，排队中的请求不计入在途数
+        if (!m_dispatcher->tryBeginRequest()) {
+            m_writer->send(RequestDispatcher::serverBusyReply("requests", m_dispatcher->busyRetryAfterMs()), m_format);
+            continue;
+        }
+
+        if (m_dispatcher->runsInline(request)) {
+            QJsonObject resp = m_dispatcher->dispatch(request);
+            m_dispatcher->endRequest();
+            m_writer->send(resp, m_format);
+            continue;
+        }
+
+        m_orderedRunning = true;
+        std::shared_ptr<ReplyStream> stream;
+        if (m_dispatcher->wantsStream(request))
+            stream = openStream(QJsonValue(QJsonValue::Undefined));
+        m_dispatcher->dispatchAsync(request, stream).then(this, [this, stream](const Reply &resp) {
+            if (stream)
+                closeStream(stream);
+            m_orderedRunning = false;
+            m_writer->send(resp, m_format);
+            checkBackpressure();
+            runOrderedRequests();
+            maybeResumeReading();
+        });
     }
-    return resp;
 }
 
-QJsonObject ClientHandler::handleRefundOrder(const QJsonObject &data)
+std::shared_ptr<ReplyStream> ClientHandler::openStream(const QJsonValue &reqId)
 {
-    QJsonObject resp;
-    resp["type"] = "refund_order_reply";
-
-    QString orderNum = data["order_id"].toString();
-    QString username = data["user_id"].toString();
-
-    QJsonObject dbResp = m_dbHandler->refundOrder(orderNum, username);
-    resp["success"] = (dbResp["code"].toInt() == 200);
-    resp["message"] = dbResp["msg"].toString();
-    return resp;
+    // 数据库线程持 stream 的锁投递，析构时先 cancel，因此这里捕获 this 是安全的
+    auto stream = std::make_shared<ReplyStream>(reqId, [this](const std::shared_ptr<ReplyStream> &target,
+                                                              const Reply &frame) {
+        QMetaObject::invokeMethod(this, [this, target, frame]() {
+            onStreamChunk(target, frame);
+        }, Qt::QueuedConnection);
+    });
+    m_streams.append(stream);
+    return stream;
 }
 
-QJsonObject ClientHandler::handleAddPassenger(const QJsonObject &data)
+void ClientHandler::onStreamChunk(const std::shared_ptr<ReplyStream> &stream, const Reply &frame)
 {
-    QJsonObject resp;
-    resp["type"] = "add_passenger_reply";
-
-    QString username = data["user_id"].toString();
-    QString realName = data["real_name"].toString();
-    QString idCard = data["ID_card_number"].toString();
-    QString phone = data["phone_number"].toString();
-
-    QJsonObject dbResp = m_dbHandler->addPassenger(username, realName, idCard, phone);
-    resp["success"] = (dbResp["code"].toInt() == 200);
-    resp["message"] = dbResp["msg"].toString();
-    return resp;
+    m_writer->send(frame, m_format);
+    checkBackpressure();
+    if (pendingWriteBytes() > m_config.writeHighWaterMark)
+        m_stalledStreams.append(stream);
+    else
+        stream->delivered();
 }
 
-QJsonObject ClientHandler::handleGetPassengers(const QJsonObject &data)
+void ClientHandler::closeStream(const std::shared_ptr<ReplyStream> &stream)
 {
-    QJsonObject resp;
-    resp["type"] = "get_passengers_reply";
-
-    QString username = data["user_id"].toString();
-    QJsonObject dbResp = m_dbHandler->getPassengers(username);
-
-    if (dbResp["code"].toInt() == 200) {
-        resp["success"] = true;
-        resp["data"] = dbResp["data"].toArray();
-    } else {
-        resp["success"] = false;
-        resp["message"] = dbResp["msg"].toString();
-    }
-    return resp;
+    m_streams.removeOne(stream);
+    m_stalledStreams.removeOne(stream);
 }
 
-QJsonObject ClientHandler::handleUpdatePassenger(const QJsonObject &data)
+void ClientHandler::releaseStalledStreams()
 {
-    QJsonObject resp;
-    resp["type"] = "update_passenger_reply";
-
-    QString passengerId = data["id"].toString();
-    QString realName = data["real_name"].toString();
-    QString idCard = data["ID_card_number"].toString();
-    QString phone = data["phone_number"].toString();
-    QString username = data["user_id"].toString(); // 用于权限验证
-
-    QJsonObject dbResp = m_dbHandler->updatePassenger(passengerId, username, realName, idCard, phone);
-    resp["success"] = (dbResp["code"].toInt() == 200);
-    resp["message"] = dbResp["msg"].toString();
-    return resp;
+    if (m_stalledStreams.isEmpty() || pendingWriteBytes() > m_config.writeLowWaterMark)
+        return;
+    for (const std::shared_ptr<ReplyStream> &stream : std::as_const(m_stalledStreams))
+        stream->delivered();
+    m_stalledStreams.clear();
 }
 
-QJsonObject ClientHandler::handleDeletePassenger(const QJsonObject &data)
+void ClientHandler::onTimer()
 {
-    QJsonObject resp;
-    resp["type"] = "delete_passenger_reply";
-
-    QString passengerId = data["id"].toString();
-    QString username = data["user_id"].toString(); // 用于权限验证
+    const ConnectionTimeouts::Action action = m_timeouts.expire();
+    if (action == ConnectionTimeouts::SendPing) {
+        m_writer->send(QJsonObject{{"type", "ping"}}, m_format);
+    } else if (action != ConnectionTimeouts::None) {
+        reap(ConnectionTimeouts::reasonText(action));
+    }
+}
 
-    QJsonObject dbResp = m_dbHandler->deletePassenger(passengerId, username);
-    resp["success"] = (dbResp["code"].toInt() == 200);
-    resp["message"] = dbResp["msg"].toString();
-    return resp;
+void ClientHandler::reap(const char *reason)
+{
+    qInfo() << "回收连接：" << m_socketDescriptor << reason;
+    ServerStats::instance().connectionsReaped.fetch_add(1, std::memory_order_relaxed);
+    m_readPaused = true;
+    m_socket->abort();
 }
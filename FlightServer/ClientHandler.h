@@ -1,45 +1,74 @@
 #ifndef CLIENTHANDLER_H
 #define CLIENTHANDLER_H
 
-#include <QThread>
+#include <QObject>
 #include <QTcpSocket>
 #include <QJsonObject>
-#include "DbHandler.h"
+#include <QQueue>
+#include <memory>
+#include "RequestDispatcher.h"
+#include "FrameDecoder.h"
+#include "ServerConfig.h"
+#include "NetworkUtils.h"
+#include "ReplyWriter.h"
+#include "ConnectionTimeouts.h"
+#include "SubscriptionHub.h"
+#include "ReplyStream.h"
 
-class ClientHandler : public QThread
+class ClientHandler : public QObject
 {
     Q_OBJECT
 public:
-    explicit ClientHandler(qintptr socketDescriptor, DbHandler *dbHandler, QObject *parent = nullptr);
+    explicit ClientHandler(qintptr socketDescriptor, const ServerConfig &config,
+                           RequestDispatcher *dispatcher, TimerWheel *timerWheel,
+                           FlightSubscriptions *subscriptions, QObject *parent = nullptr);
     ~ClientHandler();
 
-protected:
-    void run() override;
+    // 在当前（工作）线程中接管套接字，失败返回 false
+    bool start();
 
 private slots:
     void onReadyRead();
+    void onBytesWritten();
     void onDisconnected();
 
 private:
+    qint64 pendingWriteBytes() const;
+    void checkBackpressure();
+    void maybeResumeReading();
+
     void processRequest(const QJsonObject &request);
-    QJsonObject handleLogin(const QJsonObject &data);
-    QJsonObject handleRegister(const QJsonObject &data);
-    QJsonObject handleCheckPhone(const QJsonObject &data);
-    QJsonObject handleCheckIdCard(const QJsonObject &data);
-    QJsonObject handleGetUserInfo(const QJsonObject &data);
-    QJsonObject handleChangePassword(const QJsonObject &data);
-    QJsonObject handleGetFlights(const QJsonObject &data);
-    QJsonObject handleBookFlight(const QJsonObject &data);
-    QJsonObject handleGetOrders(const QJsonObject &data);
-    QJsonObject handleRefundOrder(const QJsonObject &data);
-    QJsonObject handleAddPassenger(const QJsonObject &data);
-    QJsonObject handleGetPassengers(const QJsonObject &data);
-    QJsonObject handleUpdatePassenger(const QJsonObject &data);
-    QJsonObject handleDeletePassenger(const QJsonObject &data);
+    // 逐个执行排队的顺序请求，上一个完成后才开始下一个
+    void runOrderedRequests();
+
+    // 流式回复：分块帧投递回本线程写出；待发送数据超过高水位时推迟确认，生产者随之等待
+    std::shared_ptr<ReplyStream> openStream(const QJsonValue &reqId);
+    void onStreamChunk(const std::shared_ptr<ReplyStream> &stream, const Reply &frame);
+    void closeStream(const std::shared_ptr<ReplyStream> &stream);
+    void releaseStalledStreams();
+
+    void onTimer();
+    void reap(const char *reason);
 
     qintptr m_socketDescriptor;
+    const ServerConfig &m_config;
     QTcpSocket *m_socket;
-    DbHandler *m_dbHandler;
+    ReplyWriter *m_writer;
+    RequestDispatcher *m_dispatcher;
+    FrameDecoder m_decoder;
+    NetworkUtils::WireFormat m_format = NetworkUtils::Json;
+    bool m_readPaused = false;
+
+    // 不带 req_id 的请求在数据库线程池中逐个执行，保证回复顺序与请求顺序一致
+    QQueue<QJsonObject> m_orderedRequests;
+    bool m_orderedRunning = false;
+
+    QList<std::shared_ptr<ReplyStream>> m_streams;          // 进行中的流式回复
+    QList<std::shared_ptr<ReplyStream>> m_stalledStreams;   // 等发送缓冲降到低水位后再确认
+
+    ConnectionTimeouts m_timeouts;
+    FlightSubscriptions *m_subscriptions;
+    quint64 m_subscriberId = 0;
 };
 
 #endif // CLIENTHANDLER_H
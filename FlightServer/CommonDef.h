@@ -2,13 +2,22 @@
 #define COMMONDEF_H
 
 #include <QString>
+#include <QByteArray>
+#include <QVector>
 #include <QJsonObject>
+#include <functional>
+#include <optional>
+#include <utility>
+
+// 数据访问层返回的记录，字段与数据库列对应，到连接边界才转换为回复格式
 
 struct OrderData {
     QString order_num;
     QString flight_num;
     QString from_city;
+    QString from_airport;
     QString to_city;
+    QString to_airport;
     QString date;
     QString depart_time;
     QString arrive_time;
@@ -18,14 +27,19 @@ struct OrderData {
 };
 
 struct FlightData {
+    int id = 0;
     QString flight_num;
+    QString airline;
     QString from_city;
     QString to_city;
+    QString from_airport;
+    QString to_airport;
     QString date;
     QString depart_time;
     QString arrive_time;
     QString price;
-    int remaining;
+    int remaining = 0;
+    bool is_booked = false;     // 与查询用户有关，只在回复前合并
 };
 
 struct UserData {
@@ -33,6 +47,82 @@ struct UserData {
     QString realname;
     QString phone;
     QString email;
+    QString id_card_number;
+};
+
+struct PassengerData {
+    QString id;
+    QString real_name;
+    QString id_card_number;
+    QString phone_number;
+};
+
+struct BookingData {
+    QString order_num;
+    QString seat;
+};
+
+struct SeatMapData {
+    QString flight_num;
+    QByteArray occupied;        // SeatMap::toBytes 打包的位图
+    int occupied_count = 0;
+    int remaining = 0;
+};
+
+// 数据访问的结果状态：code 沿用 HTTP 风格（200 成功），msg 为回复给客户端的说明
+struct DbStatus {
+    int code = 200;
+    QString msg;
+
+    bool ok() const { return code == 200; }
+
+    static DbStatus success(const QString &msg = QString()) { return {200, msg}; }
+    static DbStatus error(int code, const QString &msg) { return {code, msg}; }
+};
+
+// 类似 std::expected<T, DbStatus>：成功时持有值，失败时只有状态
+template <typename T>
+class DbResult
+{
+public:
+    DbResult(T value, const QString &msg = QString())
+        : m_status(DbStatus::success(msg)), m_value(std::move(value)) {}
+    DbResult(const DbStatus &status) : m_status(status) {}
+
+    bool ok() const { return m_value.has_value(); }
+    explicit operator bool() const { return ok(); }
+
+    const T &value() const { return *m_value; }
+    T &value() { return *m_value; }
+    const T &operator*() const { return *m_value; }
+    const T *operator->() const { return &*m_value; }
+
+    const DbStatus &status() const { return m_status; }
+    int code() const { return m_status.code; }
+    const QString &msg() const { return m_status.msg; }
+
+private:
+    DbStatus m_status;
+    std::optional<T> m_value;
+};
+
+// 列表查询的一页：rows 为本页的行（流式输出时为空，行已交给 sink），
+// count 为本页行数，nextCursor 非空时还有下一页
+template <typename T>
+struct Page {
+    QVector<T> rows;
+    int count = 0;
+    QString nextCursor;
+};
+
+// 列表查询的分页与流式输出参数。limit 为 0 表示取完剩余的全部行，cursor 为上一页回复中的 next_cursor；
+// 设置了 sink 时行不放进 Page::rows，而是每攒满 chunkRows 行交给 sink 一次，sink 返回 false 时停止查询
+template <typename T>
+struct PageRequest {
+    int limit = 0;
+    QString cursor;
+    int chunkRows = 100;
+    std::function<bool(const QVector<T> &rows)> sink;
 };
 
 #endif // COMMONDEF_H
@@ -0,0 +1,195 @@
+#include "ConnectionBench.h"
+#include "Acceptor.h"
+#include "WorkerPool.h"
+#include "ServerStats.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QFile>
+#include <QList>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+// 分几级打开连接
+constexpr int kSteps = 4;
+// 每打开这么多个连接处理一次事件，让接收线程及时 accept，监听队列不会满
+constexpr int kAcceptEvery = 32;
+constexpr int kListenBacklog = 1024;
+// 每级等待服务端接收完全部连接的最长时间
+constexpr int kSettleTimeoutMs = 30 * 1000;
+// 连接全部接收后再等一会儿，让工作线程建好各自的连接对象
+constexpr int kSettleMs = 200;
+
+struct ProcessUsage {
+    qint64 rssKb = 0;
+    int threads = 0;
+};
+
+ProcessUsage readUsage()
+{
+    ProcessUsage usage;
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return usage;
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith("VmRSS:"))
+            usage.rssKb = line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        else if (line.startsWith("Threads:"))
+            usage.threads = line.mid(8).trimmed().toInt();
+    }
+    return usage;
+}
+
+int connectClient(quint16 port)
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+// 等服务端接收完 target 个连接
+bool waitForActive(qint64 target)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (ServerStats::instance().connectionsActive.load(std::memory_order_relaxed) < target) {
+        if (timer.elapsed() > kSettleTimeoutMs)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    timer.restart();
+    while (timer.elapsed() < kSettleMs)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    return true;
+}
+
+void report(int connections, const ProcessUsage &usage, const ProcessUsage &base)
+{
+    const double perConnectionKb = connections > 0 ? double(usage.rssKb - base.rssKb) / connections : 0.0;
+    qInfo().noquote() << QString("  %1 个连接：RSS %2 MB，线程 %3，每连接 %4 KB")
+                             .arg(connections, 6)
+                             .arg(usage.rssKb / 1024.0, 0, 'f', 1)
+                             .arg(usage.threads)
+                             .arg(perConnectionKb, 0, 'f', 2);
+}
+}
+#endif
+
+bool ConnectionBench::raiseOpenFileLimit(int needed)
+{
+#ifdef Q_OS_LINUX
+    rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return false;
+    if (limit.rlim_cur < rlim_t(needed) && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    return limit.rlim_cur >= rlim_t(needed);
+#else
+    Q_UNUSED(needed);
+    return true;
+#endif
+}
+
+int ConnectionBench::run(const ServerConfig &config, int connections)
+{
+#ifdef Q_OS_LINUX
+    connections = qMax(1, connections);
+    // 客户端和服务端各占一个描述符
+    if (!raiseOpenFileLimit(2 * connections + 64)) {
+        qCritical() << "打开文件数上限不足以建立" << connections << "个连接，请先调高 ulimit -n";
+        return 1;
+    }
+
+    // 连接保持空闲：关掉心跳与空闲超时，也不做连接数准入
+    ServerConfig benchConfig = config;
+    benchConfig.maxConnections = 0;
+    benchConfig.heartbeatIntervalMs = 0;
+    benchConfig.idleTimeoutMs = 0;
+    benchConfig.partialFrameTimeoutMs = 0;
+
+    // 空闲连接不会发请求，不需要分发器
+    WorkerPool workers(benchConfig, nullptr);
+    workers.start();
+    Acceptor acceptor(0, benchConfig, &workers);
+    acceptor.setListenBacklogSize(kListenBacklog);
+    if (!acceptor.listen(QHostAddress::LocalHost, 0)) {
+        qCritical() << "监听失败：" << acceptor.errorString();
+        return 1;
+    }
+    const quint16 port = acceptor.serverPort();
+
+    const ProcessUsage base = readUsage();
+    qInfo().noquote() << QString("连接数基准：%1 个空闲连接，%2 后端，%3 个 I/O 线程")
+                             .arg(connections)
+                             .arg(benchConfig.ioBackend == ServerConfig::IoBackend::Epoll ? "epoll" : "qt")
+                             .arg(workers.threadCount());
+    report(0, base, base);
+
+    QList<int> fds;
+    fds.reserve(connections);
+    bool ok = true;
+    for (int step = 1; step <= kSteps && ok; ++step) {
+        const int target = int(qint64(connections) * step / kSteps);
+        // 每个连接都有一条接收日志，建立连接期间关掉调试与信息输出
+        QLoggingCategory::setFilterRules("default.debug=false\ndefault.info=false");
+        while (fds.size() < target) {
+            const int fd = connectClient(port);
+            if (fd < 0) {
+                ok = false;
+                break;
+            }
+            fds.append(fd);
+            if (fds.size() % kAcceptEvery == 0)
+                QCoreApplication::processEvents();
+        }
+        const bool settled = waitForActive(fds.size());
+        QLoggingCategory::setFilterRules(QString());
+
+        if (!ok)
+            qWarning() << "第" << fds.size() + 1 << "个连接建立失败：" << strerror(errno);
+        if (!settled) {
+            qWarning() << "服务端没有在" << kSettleTimeoutMs << "ms 内接收全部连接";
+            ok = false;
+        }
+        report(int(fds.size()), readUsage(), base);
+    }
+
+    QLoggingCategory::setFilterRules("default.debug=false\ndefault.info=false");
+    for (int fd : std::as_const(fds))
+        ::close(fd);
+    acceptor.close();
+    workers.stop();
+    QLoggingCategory::setFilterRules(QString());
+    return ok ? 0 : 1;
+#else
+    Q_UNUSED(config);
+    Q_UNUSED(connections);
+    qCritical() << "连接数基准仅支持 Linux";
+    return 1;
+#endif
+}
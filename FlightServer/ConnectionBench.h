@@ -0,0 +1,19 @@
+#ifndef CONNECTIONBENCH_H
+#define CONNECTIONBENCH_H
+
+#include "ServerConfig.h"
+
+// 连接数基准：在本进程内按 config 的 I/O 后端和线程数启动接收与 I/O 工作线程（不连接数据库），
+// 分四级打开到 connections 个空闲的本机连接，报告每级的常驻内存（VmRSS）、线程数和每连接增量。
+// 由 --bench-connections 启动，仅支持 Linux，结果打印到日志后退出
+class ConnectionBench
+{
+public:
+    // 返回进程退出码，连接没有全部建立时返回 1
+    static int run(const ServerConfig &config, int connections);
+
+    // 打开文件数软上限低于 needed 时提到硬上限，返回是否够用；非 Linux 平台总是返回 true
+    static bool raiseOpenFileLimit(int needed);
+};
+
+#endif // CONNECTIONBENCH_H
@@ -0,0 +1,98 @@
+#include "ConnectionTimeouts.h"
+
+ConnectionTimeouts::ConnectionTimeouts(const ServerConfig &config, TimerWheel *timerWheel)
+    : m_config(config), m_timerWheel(timerWheel) {}
+
+ConnectionTimeouts::~ConnectionTimeouts()
+{
+    if (m_timerId)
+        m_timerWheel->cancel(m_timerId);
+}
+
+void ConnectionTimeouts::start(std::function<void()> onTimer)
+{
+    m_onTimer = std::move(onTimer);
+    m_lastActivity = m_timerWheel->now();
+    arm();
+}
+
+void ConnectionTimeouts::touch()
+{
+    m_lastActivity = m_timerWheel->now();
+    m_pingSent = false;
+}
+
+void ConnectionTimeouts::setPartialFrame(bool partial)
+{
+    if (!partial) {
+        m_partialSince = -1;
+    } else if (m_partialSince < 0) {
+        m_partialSince = m_timerWheel->now();
+        arm();
+    }
+}
+
+ConnectionTimeouts::Action ConnectionTimeouts::expire()
+{
+    m_timerId = 0;
+    const qint64 now = m_timerWheel->now();
+
+    if (m_config.partialFrameTimeoutMs > 0 && m_partialSince >= 0
+        && now - m_partialSince >= m_config.partialFrameTimeoutMs)
+        return ReapPartialFrame;
+
+    const qint64 idle = now - m_lastActivity;
+    if (m_config.idleTimeoutMs > 0 && idle >= m_config.idleTimeoutMs)
+        return ReapIdle;
+
+    Action action = None;
+    if (m_config.heartbeatIntervalMs > 0 && !m_pingSent && idle >= m_config.heartbeatIntervalMs) {
+        m_pingSent = true;
+        action = SendPing;
+    }
+
+    arm();
+    return action;
+}
+
+const char *ConnectionTimeouts::reasonText(Action action)
+{
+    switch (action) {
+    case ReapIdle:
+        return "空闲超时";
+    case ReapPartialFrame:
+        return "半包超时";
+    default:
+        return "";
+    }
+}
+
+void ConnectionTimeouts::arm()
+{
+    if (!m_onTimer)
+        return;
+
+    // 取最近的一个截止时间：半包超时、空闲超时、发送心跳
+    qint64 due = -1;
+    auto consider = [&due](qint64 deadline) {
+        if (due < 0 || deadline < due)
+            due = deadline;
+    };
+    if (m_config.partialFrameTimeoutMs > 0 && m_partialSince >= 0)
+        consider(m_partialSince + m_config.partialFrameTimeoutMs);
+    if (m_config.idleTimeoutMs > 0)
+        consider(m_lastActivity + m_config.idleTimeoutMs);
+    if (m_config.heartbeatIntervalMs > 0 && !m_pingSent)
+        consider(m_lastActivity + m_config.heartbeatIntervalMs);
+
+    if (due < 0)
+        return;
+    // 已有更早或相同的定时器时无需重排，到期后会重新计算
+    if (m_timerId && m_timerDue <= due)
+        return;
+
+    if (m_timerId)
+        m_timerWheel->cancel(m_timerId);
+    m_timerDue = due;
+    m_timerId = m_timerWheel->schedule(qMax<qint64>(due - m_timerWheel->now(), 0), m_onTimer);
+}
@@ -0,0 +1,50 @@
+#ifndef CONNECTIONTIMEOUTS_H
+#define CONNECTIONTIMEOUTS_H
+
+#include <functional>
+#include "ServerConfig.h"
+#include "TimerWheel.h"
+
+// 单个连接的心跳、空闲与半包超时状态，Qt 与 epoll 两种 I/O 后端共用
+// 活动时只更新时间戳，到期回调中再判断是否真正超时，每个连接最多占用一个时间轮定时器
+class ConnectionTimeouts
+{
+public:
+    enum Action {
+        None,
+        SendPing,
+        ReapIdle,
+        ReapPartialFrame
+    };
+
+    ConnectionTimeouts(const ServerConfig &config, TimerWheel *timerWheel);
+    ~ConnectionTimeouts();
+
+    // 开始计时，定时器到期时在时间轮所在线程调用 onTimer
+    void start(std::function<void()> onTimer);
+
+    // 收到数据
+    void touch();
+
+    // 解码器中是否留有未完成的帧
+    void setPartialFrame(bool partial);
+
+    // 在 onTimer 中调用：返回应执行的动作，非回收时自动重新计时
+    Action expire();
+
+    static const char *reasonText(Action action);
+
+private:
+    void arm();
+
+    const ServerConfig &m_config;
+    TimerWheel *m_timerWheel;
+    std::function<void()> m_onTimer;
+    TimerWheel::TimerId m_timerId = 0;
+    qint64 m_timerDue = 0;
+    qint64 m_lastActivity = 0;
+    qint64 m_partialSince = -1;     // 缓冲区中出现未完成帧的时刻，-1 表示没有
+    bool m_pingSent = false;
+};
+
+#endif // CONNECTIONTIMEOUTS_H
@@ -0,0 +1,432 @@
+#include "DbConnectionPool.h"
+#include "ServerStats.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QMutexLocker>
+#include <QDeadlineTimer>
+#include <QDebug>
+
+// 当前线程持有的连接及嵌套深度
+namespace {
+struct HeldConnection {
+    const DbConnectionPool *pool = nullptr;
+    void *connection = nullptr;
+    int depth = 0;
+};
+thread_local HeldConnection t_held;
+}
+
+DbConnectionPool::Lease::Lease(Lease &&other) noexcept
+    : m_pool(other.m_pool), m_connection(other.m_connection), m_nested(other.m_nested),
+      m_detach(other.m_detach)
+{
+    other.m_pool = nullptr;
+    other.m_connection = nullptr;
+}
+
+DbConnectionPool::Lease &DbConnectionPool::Lease::operator=(Lease &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_pool = other.m_pool;
+        m_connection = other.m_connection;
+        m_nested = other.m_nested;
+        m_detach = other.m_detach;
+        other.m_pool = nullptr;
+        other.m_connection = nullptr;
+    }
+    return *this;
+}
+
+DbConnectionPool::Lease::~Lease()
+{
+    release();
+}
+
+QSqlDatabase DbConnectionPool::Lease::database() const
+{
+    return m_connection ? m_connection->db : QSqlDatabase();
+}
+
+QSqlQuery &DbConnectionPool::Lease::prepared(SqlStatements::Id id)
+{
+    Q_ASSERT(m_connection);
+    ServerStats &stats = ServerStats::instance();
+
+    auto it = m_connection->statements.find(int(id));
+    if (it != m_connection->statements.end()) {
+        stats.dbStatementHits.fetch_add(1, std::memory_order_relaxed);
+        return it.value();
+    }
+
+    stats.dbStatementPrepares.fetch_add(1, std::memory_order_relaxed);
+    QSqlQuery query(m_connection->db);
+    // 结果只顺序读取一遍，ODBC 不必为滚动游标缓存
+    query.setForwardOnly(true);
+    if (!query.prepare(SqlStatements::text(id))) {
+        qWarning() << "预编译语句失败：" << int(id) << query.lastError().text();
+        m_connection->failed = query;
+        return m_connection->failed;
+    }
+    return m_connection->statements.insert(int(id), query).value();
+}
+
+void DbConnectionPool::Lease::release()
+{
+    if (!m_connection)
+        return;
+
+    if (--t_held.depth == 0) {
+        t_held.pool = nullptr;
+        t_held.connection = nullptr;
+    }
+    if (!m_nested)
+        m_pool->release(m_connection, m_detach);
+
+    m_pool = nullptr;
+    m_connection = nullptr;
+}
+
+DbConnectionPool::DbConnectionPool(const QString &driver, const QString &dsn, const QString &user,
+                                   const QString &password, const Options &options)
+    : m_driver(driver), m_dsn(dsn), m_user(user), m_password(password), m_options(options)
+{
+    if (m_options.maxSize < 1)
+        m_options.maxSize = 1;
+    m_options.minSize = qBound(0, m_options.minSize, m_options.maxSize);
+    m_clock.start();
+    ServerStats::instance().setDbPoolLimits(m_options.minSize, m_options.maxSize);
+}
+
+DbConnectionPool::~DbConnectionPool()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_inUse > 0)
+        qWarning() << "连接池释放时仍有" << m_inUse << "个连接未归还";
+    QList<Connection *> closable;
+    int foreign = 0;
+    for (Connection *connection : std::as_const(m_idle)) {
+        if (closableHere(connection))
+            closable.append(connection);
+        else
+            ++foreign;
+    }
+    m_idle.clear();
+    locker.unlock();
+
+    // 属于其他线程的连接不能在这里关闭，正常退出时各线程已调用 closeOwnedConnections
+    if (foreign > 0)
+        qWarning() << "连接池释放时仍有" << foreign << "个连接属于其他线程，留给进程退出时回收";
+    for (Connection *connection : std::as_const(closable))
+        destroyConnection(connection);
+}
+
+bool DbConnectionPool::open()
+{
+    int opened = 0;
+    for (int i = 0; i < m_options.minSize; ++i) {
+        {
+            QMutexLocker locker(&m_mutex);
+            ++m_total;
+        }
+        Connection *connection = createConnection();
+        QMutexLocker locker(&m_mutex);
+        if (!connection) {
+            --m_total;
+            continue;
+        }
+        connection->db.moveToThread(nullptr);
+        connection->owner = nullptr;
+        connection->idleSince = m_clock.elapsed();
+        m_idle.append(connection);
+        ++opened;
+    }
+    qInfo() << "数据库连接池已建立" << opened << "个连接，上限" << m_options.maxSize;
+    return opened > 0 || m_options.minSize == 0;
+}
+
+DbConnectionPool::Lease DbConnectionPool::acquire(bool detachOnRelease)
+{
+    // 本线程已持有连接时直接复用，归还方式由外层决定
+    if (t_held.pool == this && t_held.connection) {
+        ++t_held.depth;
+        return Lease(this, static_cast<Connection *>(t_held.connection), true, false);
+    }
+
+    ServerStats &stats = ServerStats::instance();
+    QThread *thread = QThread::currentThread();
+    QElapsedTimer waited;
+    waited.start();
+
+    Connection *connection = nullptr;
+    for (;;) {
+        QMutexLocker locker(&m_mutex);
+        const QList<Connection *> retired = takeRetiredFor(thread);
+        if (!retired.isEmpty()) {
+            locker.unlock();
+            for (Connection *old : retired)
+                destroyConnection(old);
+            continue;
+        }
+
+        connection = takeIdleFor(thread);
+        if (connection) {
+            ++m_inUse;
+            locker.unlock();
+
+            // 未归属任何线程的连接在这里迁入；迁移失败或校验失败则丢弃重试
+            const bool stale = m_clock.elapsed() - connection->idleSince >= m_options.validateAfterIdleMs;
+            bool usable = true;
+            if (connection->owner != thread) {
+                usable = connection->db.moveToThread(thread);
+                if (usable)
+                    connection->owner = thread;
+            }
+            if (usable && (!stale || validate(connection)))
+                break;
+
+            qWarning() << "数据库连接已失效，丢弃：" << connection->name;
+            stats.dbConnectionsBroken.fetch_add(1, std::memory_order_relaxed);
+            destroyConnection(connection);
+            connection = nullptr;
+            locker.relock();
+            --m_inUse;
+            --m_total;
+            continue;
+        }
+
+        if (m_total >= m_options.maxSize) {
+            const qint64 remaining = m_options.checkoutTimeoutMs - waited.elapsed();
+            if (remaining <= 0) {
+                stats.dbCheckoutTimeouts.fetch_add(1, std::memory_order_relaxed);
+                qWarning() << "等待数据库连接超时：" << m_options.checkoutTimeoutMs << "ms";
+                return Lease();
+            }
+            // 空闲连接都属于其他线程：让最久未用的一个退役，由它的线程关闭后腾出名额。
+            // 数据库线程数固定，这种情况只在线程组合变化时出现
+            retireOldestIdle();
+            m_available.wait(&m_mutex, QDeadlineTimer(remaining));
+            continue;
+        }
+
+        ++m_total;
+        ++m_inUse;
+        locker.unlock();
+
+        connection = createConnection();
+        if (connection)
+            break;
+
+        locker.relock();
+        --m_total;
+        --m_inUse;
+        m_available.wakeOne();
+        return Lease();
+    }
+
+    const qint64 waitUs = waited.nsecsElapsed() / 1000;
+    stats.dbCheckouts.fetch_add(1, std::memory_order_relaxed);
+    stats.dbCheckoutWaitUs.fetch_add(waitUs, std::memory_order_relaxed);
+    qint64 maxWait = stats.dbCheckoutWaitMaxUs.load(std::memory_order_relaxed);
+    while (waitUs > maxWait
+           && !stats.dbCheckoutWaitMaxUs.compare_exchange_weak(maxWait, waitUs, std::memory_order_relaxed)) {}
+    stats.dbConnectionsInUse.fetch_add(1, std::memory_order_relaxed);
+
+    t_held.pool = this;
+    t_held.connection = connection;
+    t_held.depth = 1;
+    return Lease(this, connection, false, detachOnRelease);
+}
+
+DbConnectionPool::Connection *DbConnectionPool::takeIdleFor(QThread *thread)
+{
+    // 优先本线程最近归还的连接（预编译语句仍然有效），其次是未归属任何线程的连接
+    int unowned = -1;
+    for (int i = int(m_idle.size()) - 1; i >= 0; --i) {
+        if (m_idle[i]->owner == thread)
+            return m_idle.takeAt(i);
+        if (unowned < 0 && m_idle[i]->owner == nullptr)
+            unowned = i;
+    }
+    return unowned >= 0 ? m_idle.takeAt(unowned) : nullptr;
+}
+
+QList<DbConnectionPool::Connection *> DbConnectionPool::takeRetiredFor(QThread *thread)
+{
+    QList<Connection *> retired;
+    if (m_retiring == 0)
+        return retired;
+    for (int i = int(m_idle.size()) - 1; i >= 0; --i) {
+        if (m_idle[i]->retiring && m_idle[i]->owner == thread)
+            retired.append(m_idle.takeAt(i));
+    }
+    m_retiring -= int(retired.size());
+    m_total -= int(retired.size());
+    if (!retired.isEmpty())
+        m_available.wakeAll();
+    return retired;
+}
+
+void DbConnectionPool::retireOldestIdle()
+{
+    if (m_retiring > 0)
+        return;
+    for (Connection *connection : std::as_const(m_idle)) {
+        if (!connection->retiring) {
+            connection->retiring = true;
+            ++m_retiring;
+            ServerStats::instance().dbConnectionsEvicted.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+bool DbConnectionPool::closableHere(const Connection *connection)
+{
+    return connection->owner == nullptr || connection->owner == QThread::currentThread();
+}
+
+void DbConnectionPool::release(Connection *connection, bool detach)
+{
+    ServerStats::instance().dbConnectionsInUse.fetch_sub(1, std::memory_order_relaxed);
+
+    // 结束未读完的结果集，语句本身留在缓存中
+    for (QSqlQuery &query : connection->statements) {
+        if (query.isActive())
+            query.finish();
+    }
+
+    // 连接级错误说明连接已断开，不再放回池中
+    bool broken = !connection->db.isOpen()
+                  || connection->db.lastError().type() == QSqlError::ConnectionError;
+    if (broken) {
+        qWarning() << "归还时丢弃数据库连接：" << connection->name;
+        ServerStats::instance().dbConnectionsBroken.fetch_add(1, std::memory_order_relaxed);
+    } else if (detach) {
+        // 语句对象随连接留在本线程的驱动上，迁出前先丢掉
+        connection->statements.clear();
+        connection->failed = QSqlQuery();
+        broken = !connection->db.moveToThread(nullptr);
+        if (!broken)
+            connection->owner = nullptr;
+    }
+
+    QThread *thread = QThread::currentThread();
+    QMutexLocker locker(&m_mutex);
+    --m_inUse;
+    if (broken) {
+        --m_total;
+    } else {
+        connection->idleSince = m_clock.elapsed();
+        m_idle.append(connection);
+    }
+    QList<Connection *> retired = takeRetiredFor(thread);
+    // 可能有多个线程在等，只有连接所属线程能免迁移地拿到它，全部唤醒由各自挑选
+    m_available.wakeAll();
+    locker.unlock();
+
+    if (broken)
+        destroyConnection(connection);
+    for (Connection *old : std::as_const(retired))
+        destroyConnection(old);
+}
+
+void DbConnectionPool::reapIdle()
+{
+    QList<Connection *> expired;
+    int retired = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        const qint64 now = m_clock.elapsed();
+        // 最久未用的在前，只回收超过 minSize 的部分；已退役的连接也算作将要关闭
+        for (int i = 0; i < m_idle.size() && m_total - expired.size() - m_retiring > m_options.minSize;) {
+            Connection *connection = m_idle[i];
+            if (connection->retiring || now - connection->idleSince < m_options.idleTimeoutMs) {
+                ++i;
+            } else if (closableHere(connection)) {
+                expired.append(m_idle.takeAt(i));
+            } else {
+                // 属于其他线程的连接不在这里关闭，等它的线程下次检出或归还时处理
+                connection->retiring = true;
+                ++m_retiring;
+                ++retired;
+                ++i;
+            }
+        }
+        m_total -= int(expired.size());
+    }
+
+    for (Connection *connection : std::as_const(expired))
+        destroyConnection(connection);
+    if (!expired.isEmpty() || retired > 0)
+        qDebug() << "回收空闲数据库连接" << expired.size() << "个，标记退役" << retired << "个";
+}
+
+void DbConnectionPool::closeOwnedConnections()
+{
+    QThread *thread = QThread::currentThread();
+    QList<Connection *> owned;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = int(m_idle.size()) - 1; i >= 0; --i) {
+            if (m_idle[i]->owner != thread)
+                continue;
+            if (m_idle[i]->retiring)
+                --m_retiring;
+            owned.append(m_idle.takeAt(i));
+        }
+        m_total -= int(owned.size());
+        if (!owned.isEmpty())
+            m_available.wakeAll();
+    }
+
+    for (Connection *connection : std::as_const(owned))
+        destroyConnection(connection);
+}
+
+DbConnectionPool::Connection *DbConnectionPool::createConnection()
+{
+    Connection *connection = new Connection;
+    {
+        QMutexLocker locker(&m_mutex);
+        connection->name = QString("pool_%1").arg(m_nextName++);
+    }
+
+    connection->db = QSqlDatabase::addDatabase(m_driver, connection->name);
+    connection->db.setDatabaseName(m_dsn);
+    connection->db.setUserName(m_user);
+    connection->db.setPassword(m_password);
+
+    if (!connection->db.open()) {
+        qWarning() << "建立数据库连接失败：" << connection->db.lastError().text();
+        destroyConnection(connection);
+        return nullptr;
+    }
+
+    connection->owner = QThread::currentThread();
+    connection->counted = true;
+    ServerStats &stats = ServerStats::instance();
+    stats.dbConnectionsCreated.fetch_add(1, std::memory_order_relaxed);
+    stats.dbConnectionsOpen.fetch_add(1, std::memory_order_relaxed);
+    return connection;
+}
+
+bool DbConnectionPool::validate(Connection *connection)
+{
+    QSqlQuery query(connection->db);
+    return query.exec("SELECT 1") && query.next();
+}
+
+void DbConnectionPool::destroyConnection(Connection *connection)
+{
+    if (connection->counted)
+        ServerStats::instance().dbConnectionsOpen.fetch_sub(1, std::memory_order_relaxed);
+
+    connection->statements.clear();
+    connection->failed = QSqlQuery();
+    connection->db.close();
+    connection->db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(connection->name);
+    delete connection;
+}
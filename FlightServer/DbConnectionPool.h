@@ -0,0 +1,128 @@
+#ifndef DBCONNECTIONPOOL_H
+#define DBCONNECTIONPOOL_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include "SqlStatements.h"
+
+class QThread;
+
+// 有上下限的数据库连接池：按需建立连接，检出时可等待，复用前校验，空闲过久的连接被回收。
+// 连接归还后仍属于最后使用它的线程，连同其中缓存的预编译语句一起优先交还给该线程；
+// 刚建立的连接不属于任何线程，第一次检出时迁移到调用线程（QSqlDatabase::moveToThread，Qt 6.8 起）。
+// 连接只在所属线程（或不属于任何线程时）关闭；要回收属于其他线程的连接时只做退役标记，
+// 由所属线程在下一次检出或归还时关闭
+class DbConnectionPool
+{
+    struct Connection;
+
+public:
+    struct Options {
+        int minSize = 2;                    // 启动时建立并始终保留的连接数
+        int maxSize = 16;                   // 连接数上限，应小于 MySQL 的 max_connections
+        int checkoutTimeoutMs = 5000;       // 连接全部在用时最长等待时间
+        int idleTimeoutMs = 5 * 60 * 1000;  // 超过 minSize 的连接空闲这么久后关闭
+        int validateAfterIdleMs = 30 * 1000; // 空闲超过这么久的连接复用前先执行 SELECT 1
+    };
+
+    // 检出的连接，析构时归还。同一线程内嵌套检出复用外层的连接，
+    // 因此 batch 等组合请求只占用一个连接，也不会因池满而自己等待自己
+    class Lease
+    {
+    public:
+        Lease() = default;
+        Lease(Lease &&other) noexcept;
+        Lease &operator=(Lease &&other) noexcept;
+        ~Lease();
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        // 超时未拿到连接时无效，database() 返回未打开的连接
+        bool isValid() const { return m_connection != nullptr; }
+        QSqlDatabase database() const;
+
+        // 取该连接上缓存的预编译语句，第一次使用时 prepare；只能在租约有效时调用
+        QSqlQuery &prepared(SqlStatements::Id id);
+
+        void release();
+
+    private:
+        friend class DbConnectionPool;
+        Lease(DbConnectionPool *pool, Connection *connection, bool nested, bool detach)
+            : m_pool(pool), m_connection(connection), m_nested(nested), m_detach(detach) {}
+
+        DbConnectionPool *m_pool = nullptr;
+        Connection *m_connection = nullptr;
+        bool m_nested = false;
+        bool m_detach = false;
+    };
+
+    DbConnectionPool(const QString &driver, const QString &dsn, const QString &user,
+                     const QString &password, const Options &options);
+    ~DbConnectionPool();
+
+    // 建立 minSize 个连接，一个都建不起来时返回 false
+    bool open();
+
+    // 在调用线程检出一个连接，池满时最多等待 checkoutTimeoutMs。
+    // detachOnRelease 供主线程等不在数据库线程池中的线程使用：归还时丢弃语句缓存并把连接迁出本线程，
+    // 之后可被任意数据库线程迁入，不会因所属线程再也不检出而一直占着名额
+    Lease acquire(bool detachOnRelease = false);
+
+    // 关闭空闲超时的多余连接，由定时器周期调用；属于其他线程的只标记退役
+    void reapIdle();
+
+    // 关闭属于调用线程的全部空闲连接，供线程退出前调用
+    void closeOwnedConnections();
+
+    const Options &options() const { return m_options; }
+
+private:
+    struct Connection {
+        QSqlDatabase db;
+        QString name;
+        QThread *owner = nullptr;   // 连接当前所属的线程，nullptr 表示可被任意线程迁入
+        QHash<int, QSqlQuery> statements;
+        QSqlQuery failed;           // prepare 失败时返回给调用方，exec 会报告错误
+        qint64 idleSince = 0;
+        bool counted = false;       // 已计入打开的连接数
+        bool retiring = false;      // 已标记退役，等所属线程关闭
+    };
+
+    // 在锁内从空闲列表取出最适合调用线程的连接，没有返回 nullptr
+    Connection *takeIdleFor(QThread *thread);
+    // 在锁内取出属于 thread 的已退役空闲连接，m_total 同时扣除，由调用方在锁外关闭
+    QList<Connection *> takeRetiredFor(QThread *thread);
+    // 在锁内把最久未用、属于其他线程的一个空闲连接标记为退役，已有退役中的连接时不再标记
+    void retireOldestIdle();
+    // 当前线程能否关闭该连接
+    static bool closableHere(const Connection *connection);
+    Connection *createConnection();
+    bool validate(Connection *connection);
+    void destroyConnection(Connection *connection);
+    void release(Connection *connection, bool detach);
+
+    QString m_driver;
+    QString m_dsn;
+    QString m_user;
+    QString m_password;
+    Options m_options;
+
+    QMutex m_mutex;
+    QWaitCondition m_available;
+    QList<Connection *> m_idle;     // 末尾为最近归还的连接
+    int m_total = 0;                // 已建立和正在建立的连接数
+    int m_inUse = 0;
+    int m_retiring = 0;             // 已标记退役、尚未关闭的空闲连接数
+    quint64 m_nextName = 0;
+    QElapsedTimer m_clock;
+};
+
+#endif // DBCONNECTIONPOOL_H
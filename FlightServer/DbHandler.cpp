@@ -1,733 +1,914 @@
 #include "DbHandler.h"
+#include "SubscriptionHub.h"
+#include "ServerStats.h"
 #include <QSqlError>
 #include <QDebug>
 #include <QUuid>
 #include <QDateTime>
+#include <QSet>
 #include <QThread>
+#include <QSemaphore>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <algorithm>
 
-DbHandler::DbHandler(QObject *parent) : QObject(parent) {}
+// 分页游标：[类型, 排序键...] 的紧凑 JSON 再做 base64url，对客户端不透明
+static QString encodeCursor(const QJsonArray &key)
+{
+    return QString::fromLatin1(QJsonDocument(key).toJson(QJsonDocument::Compact)
+                                   .toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+// 解出 kind 类型游标中的 keySize 个排序键，格式不符返回 false
+static bool decodeCursor(const QString &cursor, const QString &kind, int keySize, QJsonArray &key)
+{
+    const auto decoded = QByteArray::fromBase64Encoding(
+        cursor.toLatin1(), QByteArray::Base64UrlEncoding | QByteArray::AbortOnBase64DecodingErrors);
+    if (!decoded)
+        return false;
+    const QJsonDocument doc = QJsonDocument::fromJson(*decoded);
+    if (!doc.isArray())
+        return false;
+    key = doc.array();
+    if (key.size() != keySize + 1 || key.first().toString() != kind)
+        return false;
+    key.removeFirst();
+    return true;
+}
+
+// 流式输出时攒满一块（或 force 时有剩余行）就交给 sink；返回 false 表示流式回复已中止
+template <typename T>
+static bool flushChunk(const PageRequest<T> &page, QVector<T> &rows, bool force)
+{
+    if (!page.sink || rows.isEmpty() || (!force && rows.size() < page.chunkRows))
+        return true;
+    const bool ok = page.sink(rows);
+    rows.clear();
+    return ok;
+}
+
+static DbStatus notConnected()
+{
+    return DbStatus::error(500, "数据库未连接");
+}
+
+static DbStatus aborted()
+{
+    return DbStatus::error(500, "回复已中止");
+}
+
+DbHandler::DbHandler(QObject *parent) : QObject(parent)
+{
+    m_pool.setObjectName("db_pool");
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+    // 连接只能在所属线程关闭，线程不能因空闲退出而把名下的连接留成孤儿
+    m_pool.setExpiryTimeout(-1);
+
+    m_reapTimer = new QTimer(this);
+    connect(m_reapTimer, &QTimer::timeout, this, [this]() {
+        if (m_connectionPool)
+            m_connectionPool->reapIdle();
+    });
+
+    // 校验查询放到数据库线程池中执行，不占用主线程
+    m_catalogTimer = new QTimer(this);
+    connect(m_catalogTimer, &QTimer::timeout, this, [this]() {
+        m_pool.start([this]() { checkFlightCatalog(); });
+    });
+}
 
 DbHandler::~DbHandler()
 {
-    if (m_db.isOpen())
-        m_db.close();
+    // 先等订退票结束，再把余票变化写完，最后由各线程关闭自己名下的连接
+    m_pool.waitForDone();
+    m_inventory.stopWriter();
+    if (m_connectionPool) {
+        runOnEachThread(m_pool.maxThreadCount(), [this]() {
+            m_connectionPool->closeOwnedConnections();
+            return true;
+        });
+    }
+    delete m_connectionPool;
 }
 
-bool DbHandler::connectDb(const QString &dsn, const QString &user, const QString &password)
+void DbHandler::setPoolOptions(const DbConnectionPool::Options &options)
 {
-    m_dsn = dsn;
-    m_user = user;
-    m_password = password;
+    m_poolOptions = options;
+}
+
+void DbHandler::setFlightCacheOptions(int maxEntries, int checkIntervalMs)
+{
+    m_flightCache.setMaxEntries(maxEntries);
+    m_flightCacheCheckMs = checkIntervalMs;
+    ServerStats::instance().setFlightCacheLimits(maxEntries, checkIntervalMs);
+}
 
-    m_db = QSqlDatabase::addDatabase("QODBC", "main_connection");
-    m_db.setDatabaseName(dsn);
-    m_db.setUserName(user);
-    m_db.setPassword(password);
+bool DbHandler::connectDb(const QString &dsn, const QString &user, const QString &password)
+{
+    delete m_connectionPool;
+    m_connectionPool = new DbConnectionPool("QODBC", dsn, user, password, m_poolOptions);
+    m_connected = m_connectionPool->open();
 
-    if (m_db.open()) {
+    if (m_connected) {
         qDebug() << "数据库连接成功";
-        return true;
+        // 空闲回收不需要很精确，按空闲超时的一半检查一次
+        m_reapTimer->start(qBound(1000, m_poolOptions.idleTimeoutMs / 2, 60 * 1000));
+
+        // 余票以内存为准，启动时整表载入一次
+        DbConnectionPool::Lease lease = acquireStartupConnection();
+        if (lease.isValid()) {
+            SeatInventory::Batch flights;
+            QSqlQuery &query = lease.prepared(SqlStatements::LoadInventory);
+            if (query.exec())
+                flights = SeatInventory::read(query);
+            else
+                qWarning() << "载入航班余票失败：" << query.lastError().text();
+            query.finish();
+
+            QSqlQuery &seats = lease.prepared(SqlStatements::ActiveSeats);
+            if (seats.exec()) {
+                const int conflicts = SeatInventory::loadSeats(flights, seats);
+                if (conflicts > 0)
+                    qWarning() << "重建座位图时发现" << conflicts << "个重复占用的座位";
+            } else {
+                qWarning() << "重建座位图失败：" << seats.lastError().text();
+            }
+            seats.finish();
+            qInfo() << "载入航班余票：" << m_inventory.publish(flights) << "个航班";
+        }
+        m_inventory.startWriter([this](const QList<SeatInventory::Delta> &deltas) {
+            return persistSeatDeltas(deltas);
+        }, [this]() { m_connectionPool->closeOwnedConnections(); });
+
+        if (m_flightCache.isEnabled() && m_flightCacheCheckMs > 0) {
+            checkFlightCatalog();   // 记录初始校验值
+            m_catalogTimer->start(m_flightCacheCheckMs);
+        }
     } else {
-        qDebug() << "数据库连接失败：" << m_db.lastError().text();
-        return false;
+        qDebug() << "数据库连接失败";
     }
+    return m_connected;
 }
 
 bool DbHandler::isConnected()
 {
-    return m_db.isOpen();
+    return m_connected;
 }
 
-QSqlDatabase DbHandler::getThreadSafeDb() {
-    QString connectionName = QString("conn_%1").arg((quintptr)QThread::currentThreadId());
+void DbHandler::setWorkerThreadCount(int count)
+{
+    m_pool.setMaxThreadCount(count > 0 ? count : QThread::idealThreadCount());
+}
 
-    if (QSqlDatabase::contains(connectionName)) {
-        QSqlDatabase db = QSqlDatabase::database(connectionName);
-        if (db.isOpen()) {
-            return db;
-        } else {
-            QSqlDatabase::removeDatabase(connectionName);
+void DbHandler::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+int DbHandler::runOnEachThread(int count, const std::function<bool()> &task)
+{
+    static constexpr int kWaitMs = 10 * 1000;
+
+    count = qBound(1, count, m_pool.maxThreadCount());
+    QSemaphore arrived;
+    QSemaphore leave;
+    QSemaphore done;
+    std::atomic<int> succeeded{0};
+
+    for (int i = 0; i < count; ++i) {
+        m_pool.start([&]() {
+            if (task())
+                succeeded.fetch_add(1, std::memory_order_relaxed);
+            arrived.release();
+            leave.tryAcquire(1, kWaitMs);
+            done.release();
+        });
+    }
+
+    // 线程池被其他任务占着时不会全部到齐，等不到也放行，只是覆盖的线程少一些
+    arrived.tryAcquire(count, kWaitMs);
+    leave.release(count);
+    done.acquire(count);
+    return succeeded.load(std::memory_order_relaxed);
+}
+
+int DbHandler::warmUpConnections(int count)
+{
+    // 连接归还后仍属于检出它的线程，其他线程不会拿走；各任务又在不同线程上，连接因此分布在 count 个线程上
+    return runOnEachThread(count, [this]() {
+        DbConnectionPool::Lease lease = acquireConnection();
+        if (!lease.isValid())
+            return false;
+        int failures = 0;
+        for (int id = 0; id < SqlStatements::Count; ++id) {
+            if (SqlStatements::text(SqlStatements::Id(id)).isEmpty())
+                continue;
+            if (lease.prepared(SqlStatements::Id(id)).lastError().isValid())
+                ++failures;
         }
-    }
+        return failures == 0;
+    });
+}
 
-    QSqlDatabase db = QSqlDatabase::addDatabase("QODBC", connectionName);
-    db.setDatabaseName(m_dsn);
-    db.setUserName(m_user);
-    db.setPassword(m_password);
+DbConnectionPool::Lease DbHandler::acquireConnection()
+{
+    if (!m_connectionPool)
+        return DbConnectionPool::Lease();
+    return m_connectionPool->acquire();
+}
 
-    if (!db.open()) {
-        qWarning() << "线程数据库连接失败：" << db.lastError().text();
-    }
-    return db;
+DbConnectionPool::Lease DbHandler::acquireStartupConnection()
+{
+    if (!m_connectionPool)
+        return DbConnectionPool::Lease();
+    return m_connectionPool->acquire(true);
 }
 
-QJsonObject DbHandler::verifyUser(const QString &phone, const QString &password)
+DbResult<UserData> DbHandler::verifyUser(const QString &phone, const QString &password)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
-    QSqlQuery query(db);
-    query.prepare("SELECT * FROM userdata WHERE phone = :phone");
+    QSqlQuery &query = lease.prepared(SqlStatements::UserByPhone);
     query.bindValue(":phone", phone);
 
-    if (query.exec() && query.next()) {
-        if (query.value("password").toString() == password) {
-            resp["code"] = 200;
-            // 确保返回完整的用户数据，包含 username 字段
-            QJsonObject userData;
-            userData["username"] = query.value("username").toString();
-            userData["realname"] = query.value("realname").toString();
-            userData["phone"] = query.value("phone").toString();
-            userData["email"] = query.value("email").toString();
-            userData["ID_card_number"] = query.value("ID_card_number").toString();
-
-            resp["data"] = userData;
-            resp["msg"] = "登录成功";
-
-            qDebug() << "登录验证成功，返回用户数据:" << userData;
-        } else {
-            resp["code"] = 401;
-            resp["msg"] = "密码错误";
-        }
-    } else {
-        resp["code"] = 404;
-        resp["msg"] = "用户不存在";
-    }
-    return resp;
+    if (!query.exec() || !query.next())
+        return DbStatus::error(404, "用户不存在");
+    if (query.value(SqlStatements::UserPassword).toString() != password)
+        return DbStatus::error(401, "密码错误");
+
+    // 确保返回完整的用户数据，包含 username 字段
+    UserData user;
+    user.username = query.value(SqlStatements::UserName).toString();
+    user.realname = query.value(SqlStatements::UserRealName).toString();
+    user.phone = query.value(SqlStatements::UserPhone).toString();
+    user.email = query.value(SqlStatements::UserEmail).toString();
+    user.id_card_number = query.value(SqlStatements::UserIdCard).toString();
+
+    qDebug() << "登录验证成功，用户:" << user.username;
+    return DbResult<UserData>(user, "登录成功");
 }
 
-QJsonObject DbHandler::registerUser(const QString &username, const QString &password,
-                                    const QString &phone, const QString &idCard)
+DbResult<UserData> DbHandler::registerUser(const QString &username, const QString &password,
+                                           const QString &phone, const QString &idCard)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
     // 检查用户名是否已存在
-    QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM userdata WHERE username = :username");
-    query.bindValue(":username", username);
+    QSqlQuery &byUsername = lease.prepared(SqlStatements::CountUserByUsername);
+    byUsername.bindValue(":username", username);
 
-    if (query.exec() && query.next() && query.value(0).toInt() > 0) {
-        resp["code"] = 409;
-        resp["msg"] = "用户名已存在";
-        return resp;
-    }
+    if (byUsername.exec() && byUsername.next() && byUsername.value(0).toInt() > 0)
+        return DbStatus::error(409, "用户名已存在");
+    byUsername.finish();
 
     // 检查手机号是否已存在
-    query.prepare("SELECT COUNT(*) FROM userdata WHERE phone = :phone");
-    query.bindValue(":phone", phone);
+    QSqlQuery &byPhone = lease.prepared(SqlStatements::CountUserByPhone);
+    byPhone.bindValue(":phone", phone);
 
-    if (query.exec() && query.next() && query.value(0).toInt() > 0) {
-        resp["code"] = 409;
-        resp["msg"] = "手机号已注册";
-        return resp;
-    }
+    if (byPhone.exec() && byPhone.next() && byPhone.value(0).toInt() > 0)
+        return DbStatus::error(409, "手机号已注册");
+    byPhone.finish();
 
     // 如果有身份证号，检查是否已存在
     if (!idCard.isEmpty()) {
-        query.prepare("SELECT COUNT(*) FROM userdata WHERE ID_card_number = :idCard");
-        query.bindValue(":idCard", idCard);
+        QSqlQuery &byIdCard = lease.prepared(SqlStatements::CountUserByIdCard);
+        byIdCard.bindValue(":idCard", idCard);
 
-        if (query.exec() && query.next() && query.value(0).toInt() > 0) {
-            resp["code"] = 409;
-            resp["msg"] = "身份证号已注册";
-            return resp;
-        }
+        if (byIdCard.exec() && byIdCard.next() && byIdCard.value(0).toInt() > 0)
+            return DbStatus::error(409, "身份证号已注册");
+        byIdCard.finish();
     }
 
     // 插入新用户（nickname 对应 username，realname 留空）
-    query.prepare("INSERT INTO userdata (username, password, phone, ID_card_number, realname) "
-                  "VALUES (:username, :password, :phone, :idCard, :realname)");
+    QSqlQuery &query = lease.prepared(SqlStatements::InsertUser);
     query.bindValue(":username", username);
     query.bindValue(":password", password);
     query.bindValue(":phone", phone);
     query.bindValue(":idCard", idCard.isEmpty() ? QVariant() : idCard);
     query.bindValue(":realname", "");  // realname 留空，因为前端没有提供
 
-    if (query.exec()) {
-        resp["code"] = 200;
-        resp["msg"] = "注册成功";
-        resp["data"] = QJsonObject{
-            {"username", username},
-            {"phone", phone}
-        };
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "注册失败: " + query.lastError().text();
-    }
+    if (!query.exec())
+        return DbStatus::error(500, "注册失败: " + query.lastError().text());
 
-    return resp;
+    UserData user;
+    user.username = username;
+    user.phone = phone;
+    return DbResult<UserData>(user, "注册成功");
 }
 
-QJsonObject DbHandler::checkPhoneExists(const QString &phone)
+DbResult<bool> DbHandler::checkPhoneExists(const QString &phone)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
-    QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM userdata WHERE phone = :phone");
+    QSqlQuery &query = lease.prepared(SqlStatements::CountUserByPhone);
     query.bindValue(":phone", phone);
 
-    if (query.exec() && query.next()) {
-        resp["code"] = 200;
-        resp["exists"] = query.value(0).toInt() > 0;
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "查询失败: " + query.lastError().text();
-    }
-
-    return resp;
+    if (query.exec() && query.next())
+        return query.value(0).toInt() > 0;
+    return DbStatus::error(500, "查询失败: " + query.lastError().text());
 }
 
-QJsonObject DbHandler::checkIdCardExists(const QString &idCard)
+DbResult<bool> DbHandler::checkIdCardExists(const QString &idCard)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
-    QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM userdata WHERE ID_card_number = :idCard");
+    QSqlQuery &query = lease.prepared(SqlStatements::CountUserByIdCard);
     query.bindValue(":idCard", idCard);
 
-    if (query.exec() && query.next()) {
-        resp["code"] = 200;
-        resp["exists"] = query.value(0).toInt() > 0;
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "查询失败: " + query.lastError().text();
-    }
-
-    return resp;
+    if (query.exec() && query.next())
+        return query.value(0).toInt() > 0;
+    return DbStatus::error(500, "查询失败: " + query.lastError().text());
 }
 
-QJsonObject DbHandler::getUserInfo(const QString &username)
+DbResult<UserData> DbHandler::getUserInfo(const QString &username)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
-    QSqlQuery query(db);
-    query.prepare("SELECT * FROM userdata WHERE username = :username");
+    QSqlQuery &query = lease.prepared(SqlStatements::UserByUsername);
     query.bindValue(":username", username);
 
-    if (query.exec() && query.next()) {
-        resp["code"] = 200;
-        resp["data"] = QJsonObject{
-            {"username", query.value("username").toString()},
-            {"realname", query.value("realname").toString()},
-            {"phone", query.value("phone").toString()},
-            {"email", query.value("email").toString()}
-        };
-    } else {
-        resp["code"] = 404;
-        resp["msg"] = "用户不存在";
-    }
-    return resp;
+    if (!query.exec() || !query.next())
+        return DbStatus::error(404, "用户不存在");
+
+    UserData user;
+    user.username = query.value(SqlStatements::UserName).toString();
+    user.realname = query.value(SqlStatements::UserRealName).toString();
+    user.phone = query.value(SqlStatements::UserPhone).toString();
+    user.email = query.value(SqlStatements::UserEmail).toString();
+    user.id_card_number = query.value(SqlStatements::UserIdCard).toString();
+    return user;
 }
 
-QJsonObject DbHandler::changePassword(const QString &username, const QString &oldPwd, const QString &newPwd)
+DbStatus DbHandler::changePassword(const QString &username, const QString &oldPwd, const QString &newPwd)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
     qDebug() << "数据库修改密码 - 查询用户名:" << username;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT password FROM userdata WHERE username = :username");
+    QSqlQuery &query = lease.prepared(SqlStatements::UserPasswordByUsername);
     query.bindValue(":username", username);
 
-    if (query.exec() && query.next()) {
-        if (query.value("password").toString() == oldPwd) {
-            query.prepare("UPDATE userdata SET password = :newPwd WHERE username = :username");
-            query.bindValue(":newPwd", newPwd);
-            query.bindValue(":username", username);
-            if (query.exec()) {
-                resp["code"] = 200;
-                resp["msg"] = "密码修改成功";
-            } else {
-                resp["code"] = 500;
-                resp["msg"] = "密码修改失败";
-            }
-        } else {
-            resp["code"] = 401;
-            resp["msg"] = "原密码错误";
-        }
-    } else {
-        resp["code"] = 404;
-        resp["msg"] = "用户不存在";
+    if (!query.exec() || !query.next()) {
         qDebug() << "用户不存在 - 查询的用户名:" << username;
-    }
-    return resp;
+        return DbStatus::error(404, "用户不存在");
+    }
+    if (query.value(0).toString() != oldPwd)
+        return DbStatus::error(401, "原密码错误");
+    query.finish();
+
+    QSqlQuery &update = lease.prepared(SqlStatements::UpdateUserPassword);
+    update.bindValue(":newPwd", newPwd);
+    update.bindValue(":username", username);
+    if (!update.exec())
+        return DbStatus::error(500, "密码修改失败");
+    return DbStatus::success("密码修改成功");
 }
 
-QJsonObject DbHandler::getFlightList(const QString &username, const QString &fromCity, const QString &toCity, const QString &date)
+DbResult<Page<FlightData>> DbHandler::getFlightList(const QString &username, const QString &fromCity,
+                                                    const QString &toCity, const QString &date,
+                                                    const PageRequest<FlightData> &page)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
+    DbConnectionPool::Lease lease;
 
-    // 1. 检查数据库连接
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        qDebug() << "Database not open!";
-        return resp;
-    }
+    QJsonArray cursorKey;
+    if (!page.cursor.isEmpty() && !decodeCursor(page.cursor, "f", 1, cursorKey))
+        return DbStatus::error(400, "无效的分页游标");
 
-    QSqlQuery query(db);
-
-    // 2. 构造 SQL 语句
-    // 使用子查询：在查询 flightdata 的同时，去 orders 表里统计该用户对该航班的有效订单数
-    // 如果 count > 0，说明已预订
-    QString sql = R"(
-        SELECT f.*,
-               (SELECT COUNT(*)
-                FROM orders o
-                WHERE o.flight_id = f.id
-                  AND o.username = :username
-                  AND (o.status = '待出行' OR o.status = '已完成')
-               ) as is_booked_count
-        FROM flightdata f
-        WHERE 1=1
-    )";
-
-    // 3. 动态拼接筛选条件
-    // 注意：这里的字段名要和数据库 flightdata 表一致，建议加上别名 f. 以防歧义
-    if (!fromCity.isEmpty()) sql += " AND f.from_city = :from";
-    if (!toCity.isEmpty())   sql += " AND f.to_city = :to";
-    if (!date.isEmpty())     sql += " AND f.date = :date";
-
-    query.prepare(sql);
-
-    // 4. 绑定参数
-    // 绑定当前查询的用户 (用于判断是否预订)
-    query.bindValue(":username", username);
-    //qDebug() << "------------------------------------------------";
-    //qDebug() << "[查询预订状态] 用户名(username):" << username;
-    //qDebug() << "------------------------------------------------";
+    // 1. 先查缓存，同一路线同一天的查询大多不必访问数据库
+    const QString cacheKey = SubscriptionHub::routeKey(fromCity, toCity, date);
+    FlightSearchCache::Rows rows = m_flightCache.isEnabled() ? m_flightCache.find(cacheKey) : nullptr;
 
-    // 绑定筛选条件
-    if (!fromCity.isEmpty()) query.bindValue(":from", fromCity);
-    if (!toCity.isEmpty())   query.bindValue(":to", toCity);
-    if (!date.isEmpty())     query.bindValue(":date", date);
+    if (!rows) {
+        lease = acquireConnection();
+        QSqlDatabase db = lease.database();
 
-    QJsonArray arr;
+        // 2. 检查数据库连接
+        if (!db.isOpen()) {
+            qDebug() << "Database not open!";
+            return notConnected();
+        }
 
-    // 5. 执行查询与数据映射
-    if (query.exec()) {
-        while (query.next()) {
-            QJsonObject item;
-
-            // --- 基础信息 ---
-            item["flight_number"] = query.value("flight_num").toString();
-            item["airline"] = query.value("airline").toString(); // 如果表里有就取消注释
-
-            // --- 城市与机场 ---
-            item["startCity"]    = query.value("from_city").toString();
-            item["endCity"]      = query.value("to_city").toString();
-            item["startAirport"] = query.value("from_airport").toString();
-            item["endAirport"]   = query.value("to_airport").toString();
-
-            // --- 时间信息 ---
-            item["startDate"] = query.value("date").toString();
-            item["endDate"]   = query.value("date").toString();
-            item["startTime"] = query.value("depart_Time").toString();
-            item["endTime"]   = query.value("arrive_Time").toString();
-
-            // --- 状态与价格 ---
-            int remaining = query.value("remaining").toInt();
-            QString statusStr;
-            if (remaining > 0) {
-                statusStr = "有票";
-            } else {
-                statusStr = "售罄";
-            }
-            item["status"] = statusStr;
-            item["price"] = query.value("price").toString();
+        // 3. 取出按筛选条件组合缓存的预编译语句并绑定筛选条件
+        const quint64 generation = m_flightCache.generation();
+        QSqlQuery &query = lease.prepared(SqlStatements::flightList(!fromCity.isEmpty(), !toCity.isEmpty(), !date.isEmpty()));
+        if (!fromCity.isEmpty()) query.bindValue(":from", fromCity);
+        if (!toCity.isEmpty())   query.bindValue(":to", toCity);
+        if (!date.isEmpty())     query.bindValue(":date", date);
 
-            // 读取我们刚才在 SQL 里生成的临时列 is_booked_count
-            int bookedCount = query.value("is_booked_count").toInt();
+        if (!query.exec()) {
+            qDebug() << "SQL Error:" << query.lastError().text();
+            return DbStatus::error(500, "查询失败: " + query.lastError().text());
+        }
 
-            // 如果计数大于0，说明有“已预订”或“已完成”的订单
-            item["isBooked"] = (bookedCount > 0);
+        // 4. 按列位置映射为与用户无关的航班行
+        auto loaded = std::make_shared<QVector<FlightData>>();
+        while (query.next()) {
+            FlightData flight;
+            flight.id = query.value(SqlStatements::FlightId).toInt();
+            flight.flight_num = query.value(SqlStatements::FlightNum).toString();
+            flight.airline = query.value(SqlStatements::FlightAirline).toString();
+            flight.from_city = query.value(SqlStatements::FlightFromCity).toString();
+            flight.to_city = query.value(SqlStatements::FlightToCity).toString();
+            flight.from_airport = query.value(SqlStatements::FlightFromAirport).toString();
+            flight.to_airport = query.value(SqlStatements::FlightToAirport).toString();
+            flight.date = query.value(SqlStatements::FlightDate).toString();
+            flight.depart_time = query.value(SqlStatements::FlightDepartTime).toString();
+            flight.arrive_time = query.value(SqlStatements::FlightArriveTime).toString();
+            flight.price = query.value(SqlStatements::FlightPrice).toString();
+            flight.remaining = query.value(SqlStatements::FlightRemaining).toInt();
+            loaded->append(flight);
+        }
+        query.finish();
+
+        rows = loaded;
+        m_flightCache.insert(cacheKey, rows, generation);
+    }
+
+    // 5. 当前用户有效订单（待出行或已完成）涉及的航班，通常直接来自内存
+    const QSet<int> booked = username.isEmpty() ? QSet<int>() : bookedFlights(lease, username);
+    // 之后只读内存，流式输出等待客户端时不占用数据库连接
+    lease.release();
+
+    // 6. 行按 id 升序，游标之后的第一行用二分查找定位
+    auto begin = rows->cbegin();
+    if (!cursorKey.isEmpty()) {
+        const int afterId = cursorKey.first().toInt();
+        begin = std::upper_bound(rows->cbegin(), rows->cend(), afterId,
+                                 [](int id, const FlightData &flight) { return id < flight.id; });
+    }
+    const qsizetype available = rows->cend() - begin;
+    const qsizetype count = page.limit > 0 ? qMin<qsizetype>(page.limit, available) : available;
+    const auto end = begin + count;
+
+    // 7. 合并共享的航班行、内存中的余票和用户的预订状态
+    Page<FlightData> result;
+    for (auto it = begin; it != end; ++it) {
+        FlightData flight = *it;
+
+        // 余票以内存为准，数据库中的值可能还没写回
+        if (const SeatInventory::Flight *live = m_inventory.find(flight.id))
+            flight.remaining = live->remaining.load(std::memory_order_relaxed);
+        flight.is_booked = booked.contains(flight.id);
+
+        result.rows.append(flight);
+        if (!flushChunk(page, result.rows, false))
+            return aborted();
+    }
+    if (!flushChunk(page, result.rows, true))
+        return aborted();
+
+    result.count = int(count);
+    if (count < available)
+        result.nextCursor = encodeCursor(QJsonArray{"f", (end - 1)->id});
+    qDebug() << "Query success, found rows:" << count;
+    return result;
+}
 
-            //qDebug() << "------------------------------------------------";
-            //qDebug() << "[是否预定调试] 收到预订请求:";
-            //qDebug() << "[是否预定调试] 预定状态:" << item["isBooked"].toBool();
-            //qDebug() << "------------------------------------------------";
+QSet<int> DbHandler::bookedFlights(DbConnectionPool::Lease &lease, const QString &username)
+{
+    QSet<int> flights;
+    if (m_bookedFlights.lookup(username, flights))
+        return flights;
 
-            arr.append(item);
-        }
+    if (!lease.isValid())
+        lease = acquireConnection();
+    if (!lease.isValid())
+        return flights;
+
+    // 查询失败时不完成载入，下次查询再试，不把空集合当成结果缓存下来
+    QSqlQuery &query = lease.prepared(SqlStatements::BookedFlightsByUser);
+    query.bindValue(":username", username);
+    if (!query.exec()) {
+        qWarning() << "载入用户订单失败：" << query.lastError().text();
+        return flights;
+    }
+    QHash<QString, int> orders;
+    while (query.next())
+        orders.insert(query.value(0).toString(), query.value(1).toInt());
+    m_bookedFlights.finishLoad(username, orders, flights);
+    return flights;
+}
 
-        resp["code"] = 200;
-        resp["data"] = arr;
-        qDebug() << "Query success, found rows:" << arr.size();
+void DbHandler::checkFlightCatalog()
+{
+    DbConnectionPool::Lease lease = acquireConnection();
+    if (!lease.isValid())
+        return;
 
+    QSqlQuery &query = lease.prepared(SqlStatements::FlightCatalogChecksum);
+    if (query.exec() && query.next()) {
+        const QString version = query.value(0).toString() + ":" + query.value(1).toString();
+        if (m_flightCache.updateCatalogVersion(version))
+            qInfo() << "航班目录已被外部修改，清空航班查询缓存";
     } else {
-        resp["code"] = 500;
-        resp["msg"] = "查询失败: " + query.lastError().text();
-        qDebug() << "SQL Error:" << query.lastError().text();
+        // 无法校验时宁可清空，不让缓存无限期地旧下去
+        qWarning() << "航班目录校验失败：" << query.lastError().text();
+        m_flightCache.clear();
     }
+}
 
-    return resp;
+DbResult<BookingData> DbHandler::bookFlight(const QString &username, const QString &flightNum,
+                                            const QString &seatPreference)
+{
+    SeatMap::Preference preference;
+    if (!SeatMap::preferenceFromName(seatPreference, preference))
+        return DbStatus::error(400, "不支持的座位偏好：" + seatPreference);
+
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
+
+    SeatInventory::Flight *flight = findFlight(lease, flightNum);
+    if (!flight)
+        return DbStatus::error(404, "航班不存在");
+
+    // 先在内存中占座，并发订同一航班时不会超卖，也不再锁 flightdata 的行
+    if (!m_inventory.reserve(flight))
+        return DbStatus::error(400, "航班已售罄");
+    const int seatIndex = flight->seats.allocate(preference);
+    if (seatIndex < 0) {
+        m_inventory.cancel(flight);
+        return DbStatus::error(400, "航班已售罄");
+    }
+    const QString seat = SeatMap::seatLabel(seatIndex);
+
+    QString orderNum = QUuid::createUuid().toString().remove("{").remove("}").remove("-");
+    QSqlQuery &insert = lease.prepared(SqlStatements::InsertOrder);
+    insert.bindValue(":order_num", orderNum);
+    insert.bindValue(":username", username);
+    insert.bindValue(":flight_id", flight->id);
+    insert.bindValue(":passenger", username);
+    insert.bindValue(":seat", seat);
+    insert.bindValue(":price", flight->price);
+
+    if (!insert.exec()) {
+        flight->seats.release(seatIndex);
+        m_inventory.cancel(flight);
+        return DbStatus::error(500, "订单创建失败");
+    }
+
+    // 余票由写线程合并后写回数据库
+    m_inventory.confirm(flight);
+    m_bookedFlights.addOrder(username, orderNum, flight->id);
+    publishRemaining(flight);
+    return DbResult<BookingData>(BookingData{orderNum, seat}, "预订成功");
 }
 
-QJsonObject DbHandler::bookFlight(const QString &username, const QString &flightNum)
+SeatInventory::Flight *DbHandler::findFlight(DbConnectionPool::Lease &lease, const QString &flightNum)
 {
-    // === 【新增调试打印】 ===
-    qDebug() << "------------------------------------------------";
-    qDebug() << "[预订调试] 收到预订请求:";
-    qDebug() << "[预订调试] 用户名(username):" << username;
-    qDebug() << "[预订调试] 航班号(flightNum):" << flightNum;
-    qDebug() << "------------------------------------------------";
+    SeatInventory::Flight *flight = m_inventory.find(flightNum);
+    if (flight)
+        return flight;
 
+    QSqlQuery &query = lease.prepared(SqlStatements::FlightForBooking);
+    query.bindValue(":flight_num", flightNum);
+    if (!query.exec())
+        return nullptr;
+    return loadFlight(lease, query);
+}
 
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+SeatInventory::Flight *DbHandler::findFlight(DbConnectionPool::Lease &lease, int flightId)
+{
+    SeatInventory::Flight *flight = m_inventory.find(flightId);
+    if (flight)
+        return flight;
+
+    QSqlQuery &query = lease.prepared(SqlStatements::FlightForRefund);
+    query.bindValue(":flight_id", flightId);
+    if (!query.exec())
+        return nullptr;
+    return loadFlight(lease, query);
+}
 
-    QSqlQuery query(db);
-    query.prepare("SELECT id, remaining, price FROM flightdata WHERE flight_num = :flight_num");
-    query.bindValue(":flight_num", flightNum);
-    if (query.exec() && query.next()) {
-        int flightId = query.value("id").toInt();
-        int remaining = query.value("remaining").toInt();
-        QString price = query.value("price").toString();
-
-        if (remaining <= 0) {
-            resp["code"] = 400;
-            resp["msg"] = "航班已售罄";
-            return resp;
-        }
+SeatInventory::Flight *DbHandler::loadFlight(DbConnectionPool::Lease &lease, QSqlQuery &query)
+{
+    SeatInventory::Batch batch = SeatInventory::read(query);
+    query.finish();
+    if (batch.empty())
+        return nullptr;
+
+    // 按已有订单补上座位图后才发布，其他线程不会在座位图建好前就拿它订票。
+    // 座位图建不起来时不发布，这次按航班不存在处理，下次请求再载入
+    QSqlQuery &seats = lease.prepared(SqlStatements::ActiveSeatsByFlight);
+    for (const auto &staged : batch) {
+        seats.bindValue(":flight_id", staged->id);
+        if (!seats.exec())
+            return nullptr;
+        SeatInventory::loadSeats(batch, seats);
+        seats.finish();
+    }
+    const int flightId = batch.front()->id;
+    m_inventory.publish(batch);
+    // 并发载入同一航班时以先发布的为准
+    return m_inventory.find(flightId);
+}
 
-        QString orderNum = QUuid::createUuid().toString().remove("{").remove("}").remove("-");
-        query.prepare("INSERT INTO orders (order_num, username, flight_id, passenger, seat, price, status, create_time) VALUES (:order_num, :username, :flight_id, :passenger, :seat, :price, '待出行', NOW())");
-        query.bindValue(":order_num", orderNum);
-        query.bindValue(":username", username);
-        query.bindValue(":flight_id", flightId);
-        query.bindValue(":passenger", username);
-        query.bindValue(":seat", QString("%1%2").arg(rand() % 30 + 1).arg(QChar('A' + (rand() % 6))));
-        query.bindValue(":price", price);
-
-        if (query.exec()) {
-            query.prepare("UPDATE flightdata SET remaining = remaining - 1 WHERE id = :flight_id");
-            query.bindValue(":flight_id", flightId);
-            query.exec();
-
-            resp["code"] = 200;
-            resp["msg"] = "预订成功";
-            resp["data"] = QJsonObject{{"order_num", orderNum}};
-        } else {
-            resp["code"] = 500;
-            resp["msg"] = "订单创建失败";
+DbResult<SeatMapData> DbHandler::getSeatMap(const QString &flightNum)
+{
+    SeatInventory::Flight *flight = m_inventory.find(flightNum);
+    if (!flight) {
+        DbConnectionPool::Lease lease = acquireConnection();
+        if (lease.isValid())
+            flight = findFlight(lease, flightNum);
+    }
+    if (!flight)
+        return DbStatus::error(404, "航班不存在");
+
+    SeatMapData map;
+    map.flight_num = flight->flightNum;
+    map.occupied = flight->seats.toBytes();
+    map.occupied_count = flight->seats.occupiedCount();
+    map.remaining = flight->remaining.load(std::memory_order_relaxed);
+    return map;
+}
+
+bool DbHandler::persistSeatDeltas(const QList<SeatInventory::Delta> &deltas)
+{
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return false;
+
+    if (!db.transaction()) {
+        qWarning() << "余票写回开启事务失败：" << db.lastError().text();
+        return false;
+    }
+    QSqlQuery &update = lease.prepared(SqlStatements::AdjustRemaining);
+    for (const SeatInventory::Delta &delta : deltas) {
+        update.bindValue(":delta", delta.delta);
+        update.bindValue(":flight_id", delta.flightId);
+        if (!update.exec()) {
+            qWarning() << "余票写回失败：" << update.lastError().text();
+            db.rollback();
+            return false;
         }
-    } else {
-        resp["code"] = 404;
-        resp["msg"] = "航班不存在";
     }
-    return resp;
+    return db.commit();
 }
 
-QJsonObject DbHandler::getOrderListWithFlight(const QString &username)
+void DbHandler::publishRemaining(const SeatInventory::Flight *flight)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    SubscriptionHub &hub = SubscriptionHub::instance();
+    if (!hub.hasSubscribers())
+        return;
+    hub.publish(flight->flightNum, flight->fromCity, flight->toCity, flight->date, flight->remaining);
+}
 
-    QSqlQuery query(db);
-    query.prepare(R"(
-        SELECT o.order_num, o.status, o.price, o.create_time,
-               f.flight_num, f.from_city, f.from_airport, f.to_city, f.to_airport,
-               f.date, f.depart_time, f.arrive_time
-        FROM orders o
-        LEFT JOIN flightdata f ON o.flight_id = f.id
-        WHERE o.username = :username
-        ORDER BY o.create_time DESC
-    )");
-    query.bindValue(":username", username);
+DbResult<Page<OrderData>> DbHandler::getOrderListWithFlight(const QString &username,
+                                                            const PageRequest<OrderData> &page)
+{
+    QJsonArray cursorKey;
+    const bool afterCursor = !page.cursor.isEmpty();
+    if (afterCursor && !decodeCursor(page.cursor, "o", 2, cursorKey))
+        return DbStatus::error(400, "无效的分页游标");
 
-    QJsonArray arr;
-    if (query.exec()) {
-        while (query.next()) {
-            arr.append(QJsonObject{
-                {"order_num", query.value("order_num").toString()},
-                {"flight_num", query.value("flight_num").toString()},
-                {"from_city", query.value("from_city").toString()},
-                {"from_airport", query.value("from_airport").toString()}, // 新增
-                {"to_city", query.value("to_city").toString()},
-                {"to_airport", query.value("to_airport").toString()},   // 新增
-                {"date", query.value("date").toString()},
-                {"depart_time", query.value("depart_time").toString()},
-                {"arrive_time", query.value("arrive_time").toString()},
-                {"status", query.value("status").toString()},
-                {"price", query.value("price").toString()},
-                {"create_time", query.value("create_time").toString()}
-            });
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
+
+    QSqlQuery &query = lease.prepared(SqlStatements::orderList(afterCursor, page.limit > 0));
+    query.bindValue(":username", username);
+    if (afterCursor) {
+        // 游标中的时间是 create_time 的 ISO 文本，按日期时间绑定，比较时不依赖服务器的字符串转换
+        const QString cursorTime = cursorKey.at(0).toString();
+        const QDateTime time = QDateTime::fromString(cursorTime, Qt::ISODate);
+        const QVariant timeValue = time.isValid() ? QVariant(time) : QVariant(cursorTime);
+        query.bindValue(":cursor_time", timeValue);
+        query.bindValue(":cursor_time_eq", timeValue);
+        query.bindValue(":cursor_order", cursorKey.at(1).toString());
+    }
+    // 多取一行，用来判断是否还有下一页
+    if (page.limit > 0)
+        query.bindValue(":limit", page.limit + 1);
+
+    if (!query.exec())
+        return DbStatus::error(500, "订单查询失败");
+
+    Page<OrderData> result;
+    bool more = false;
+    OrderData order;
+    while (query.next()) {
+        if (page.limit > 0 && result.count == page.limit) {
+            more = true;
+            break;
         }
-        resp["code"] = 200;
-        resp["data"] = arr;
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "订单查询失败";
-    }
-    return resp;
+        order.order_num = query.value(SqlStatements::OrderNum).toString();
+        order.status = query.value(SqlStatements::OrderStatus).toString();
+        order.price = query.value(SqlStatements::OrderPrice).toString();
+        order.create_time = query.value(SqlStatements::OrderCreateTime).toString();
+        order.flight_num = query.value(SqlStatements::OrderFlightNum).toString();
+        order.from_city = query.value(SqlStatements::OrderFromCity).toString();
+        order.from_airport = query.value(SqlStatements::OrderFromAirport).toString();
+        order.to_city = query.value(SqlStatements::OrderToCity).toString();
+        order.to_airport = query.value(SqlStatements::OrderToAirport).toString();
+        order.date = query.value(SqlStatements::OrderDate).toString();
+        order.depart_time = query.value(SqlStatements::OrderDepartTime).toString();
+        order.arrive_time = query.value(SqlStatements::OrderArriveTime).toString();
+        result.rows.append(order);
+        ++result.count;
+
+        // 流式输出时边读边发，内存中最多一块
+        if (!flushChunk(page, result.rows, false))
+            return aborted();
+    }
+    query.finish();
+    if (!flushChunk(page, result.rows, true))
+        return aborted();
+
+    // order 为本页最后一行
+    if (more)
+        result.nextCursor = encodeCursor(QJsonArray{"o", order.create_time, order.order_num});
+    return result;
 }
 
-QJsonObject DbHandler::refundOrder(const QString &orderNum, const QString &username)
+DbStatus DbHandler::refundOrder(const QString &orderNum, const QString &username)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
-    QSqlQuery query(db);
-    query.prepare(R"(
-        SELECT o.flight_id, o.status FROM orders o
-        WHERE o.order_num = :order_num AND o.username = :username
-    )");
+    QSqlQuery &query = lease.prepared(SqlStatements::OrderForRefund);
     query.bindValue(":order_num", orderNum);
     query.bindValue(":username", username);
 
-    if (query.exec() && query.next()) {
-        QString status = query.value("status").toString();
-        if (status == "已退票") {
-            resp["code"] = 400;
-            resp["msg"] = "订单已退票";
-            return resp;
-        }
-
-        int flightId = query.value("flight_id").toInt();
-        query.prepare("UPDATE orders SET status = '已退票' WHERE order_num = :order_num");
-        query.bindValue(":order_num", orderNum);
-        if (query.exec()) {
-            query.prepare("UPDATE flightdata SET remaining = remaining + 1 WHERE id = :flight_id");
-            query.bindValue(":flight_id", flightId);
-            query.exec();
-
-            resp["code"] = 200;
-            resp["msg"] = "退票成功";
-        } else {
-            resp["code"] = 500;
-            resp["msg"] = "退票失败";
-        }
+    if (!query.exec() || !query.next())
+        return DbStatus::error(404, "订单不存在或不属于当前用户");
+    if (query.value(SqlStatements::RefundStatus).toString() == "已退票")
+        return DbStatus::error(400, "订单已退票");
+
+    const int flightId = query.value(SqlStatements::RefundFlightId).toInt();
+    const QString seat = query.value(SqlStatements::RefundSeat).toString();
+    const int seatIndex = SeatMap::seatIndex(seat);
+    query.finish();
+
+    // 航班不在内存中时先按未退票订单载入，此时这张订单的座位还在座位图里，下面才归还得到
+    SeatInventory::Flight *flight = findFlight(lease, flightId);
+
+    QSqlQuery &markRefunded = lease.prepared(SqlStatements::MarkOrderRefunded);
+    markRefunded.bindValue(":order_num", orderNum);
+    if (!markRefunded.exec())
+        return DbStatus::error(500, "退票失败");
+
+    // 同一订单并发退票时只有把状态改掉的那一次归还座位
+    if (markRefunded.numRowsAffected() == 0)
+        return DbStatus::error(400, "订单已退票");
+
+    m_bookedFlights.removeOrder(username, orderNum);
+    if (flight) {
+        // 座位号解析不了的旧订单从未占过座位图，退掉它不会空出座位，余票不变
+        if (m_inventory.release(flight, seatIndex))
+            publishRemaining(flight);
+        else
+            qWarning() << "退票的座位不在座位图中，余票不变：" << orderNum << flight->flightNum << seat;
     } else {
-        resp["code"] = 404;
-        resp["msg"] = "订单不存在或不属于当前用户";
-    }
-    return resp;
+        // 航班载入失败时退回直接改数据库
+        QSqlQuery &update = lease.prepared(SqlStatements::AdjustRemaining);
+        update.bindValue(":delta", 1);
+        update.bindValue(":flight_id", flightId);
+        if (!update.exec())
+            qWarning() << "退票归还余票失败：" << orderNum << update.lastError().text();
+    }
+    return DbStatus::success("退票成功");
 }
 
-QJsonObject DbHandler::addPassenger(const QString &username, const QString &realName,
-                                    const QString &idCard, const QString &phone)
+DbStatus DbHandler::addPassenger(const QString &username, const QString &realName,
+                                 const QString &idCard, const QString &phone)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
     // 检查身份证是否已存在
-    QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM passengers WHERE ID_card_number = :idCard AND username = :username");
-    query.bindValue(":idCard", idCard);
-    query.bindValue(":username", username);
+    QSqlQuery &existing = lease.prepared(SqlStatements::CountPassengerByIdCard);
+    existing.bindValue(":idCard", idCard);
+    existing.bindValue(":username", username);
 
-    if (query.exec() && query.next() && query.value(0).toInt() > 0) {
-        resp["code"] = 409;
-        resp["msg"] = "该身份证号已存在";
-        return resp;
-    }
+    if (existing.exec() && existing.next() && existing.value(0).toInt() > 0)
+        return DbStatus::error(409, "该身份证号已存在");
+    existing.finish();
 
     // 插入新乘机人
-    query.prepare("INSERT INTO passengers (username, real_name, ID_card_number, phone_number) "
-                  "VALUES (:username, :realName, :idCard, :phone)");
+    QSqlQuery &query = lease.prepared(SqlStatements::InsertPassenger);
     query.bindValue(":username", username);
     query.bindValue(":realName", realName);
     query.bindValue(":idCard", idCard);
     query.bindValue(":phone", phone);
 
-    if (query.exec()) {
-        resp["code"] = 200;
-        resp["msg"] = "添加成功";
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "添加失败: " + query.lastError().text();
-    }
-
-    return resp;
+    if (!query.exec())
+        return DbStatus::error(500, "添加失败: " + query.lastError().text());
+    return DbStatus::success("添加成功");
 }
 
-QJsonObject DbHandler::getPassengers(const QString &username)
+DbResult<QVector<PassengerData>> DbHandler::getPassengers(const QString &username)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
-    QSqlQuery query(db);
-    query.prepare("SELECT id, real_name, ID_card_number, phone_number FROM passengers WHERE username = :username");
+    QSqlQuery &query = lease.prepared(SqlStatements::PassengersByUser);
     query.bindValue(":username", username);
 
-    QJsonArray passengers;
-    if (query.exec()) {
-        while (query.next()) {
-            QJsonObject passenger;
-            passenger["id"] = query.value("id").toString();
-            passenger["real_name"] = query.value("real_name").toString();
-            passenger["ID_card_number"] = query.value("ID_card_number").toString();
-            passenger["phone_number"] = query.value("phone_number").toString();
-            passengers.append(passenger);
-        }
-        resp["code"] = 200;
-        resp["data"] = passengers;
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "查询失败: " + query.lastError().text();
-    }
+    if (!query.exec())
+        return DbStatus::error(500, "查询失败: " + query.lastError().text());
 
-    return resp;
+    QVector<PassengerData> passengers;
+    while (query.next()) {
+        PassengerData passenger;
+        passenger.id = query.value(SqlStatements::PassengerId).toString();
+        passenger.real_name = query.value(SqlStatements::PassengerRealName).toString();
+        passenger.id_card_number = query.value(SqlStatements::PassengerIdCard).toString();
+        passenger.phone_number = query.value(SqlStatements::PassengerPhone).toString();
+        passengers.append(passenger);
+    }
+    return passengers;
 }
 
-QJsonObject DbHandler::updatePassenger(const QString &passengerId, const QString &username,
-                                       const QString &realName, const QString &idCard, const QString &phone)
+DbStatus DbHandler::updatePassenger(const QString &passengerId, const QString &username,
+                                    const QString &realName, const QString &idCard, const QString &phone)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
     // 先验证该乘机人属于当前用户（防止越权修改）
-    QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM passengers WHERE id = :id AND username = :username");
-    query.bindValue(":id", passengerId);
-    query.bindValue(":username", username);
+    QSqlQuery &owned = lease.prepared(SqlStatements::CountPassengerOwned);
+    owned.bindValue(":id", passengerId);
+    owned.bindValue(":username", username);
 
-    if (query.exec() && query.next()) {
-        if (query.value(0).toInt() == 0) {
-            resp["code"] = 403;
-            resp["msg"] = "无权修改该乘机人信息";
-            return resp;
-        }
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "验证权限失败: " + query.lastError().text();
-        return resp;
-    }
+    if (!owned.exec() || !owned.next())
+        return DbStatus::error(500, "验证权限失败: " + owned.lastError().text());
+    if (owned.value(0).toInt() == 0)
+        return DbStatus::error(403, "无权修改该乘机人信息");
+    owned.finish();
 
     // 检查身份证号是否与其他乘机人冲突（排除自己）
-    query.prepare("SELECT COUNT(*) FROM passengers WHERE ID_card_number = :idCard AND username = :username AND id != :id");
-    query.bindValue(":idCard", idCard);
-    query.bindValue(":username", username);
-    query.bindValue(":id", passengerId);
+    QSqlQuery &conflict = lease.prepared(SqlStatements::CountPassengerIdCardConflict);
+    conflict.bindValue(":idCard", idCard);
+    conflict.bindValue(":username", username);
+    conflict.bindValue(":id", passengerId);
 
-    if (query.exec() && query.next() && query.value(0).toInt() > 0) {
-        resp["code"] = 409;
-        resp["msg"] = "该身份证号已被其他乘机人使用";
-        return resp;
-    }
+    if (conflict.exec() && conflict.next() && conflict.value(0).toInt() > 0)
+        return DbStatus::error(409, "该身份证号已被其他乘机人使用");
+    conflict.finish();
 
     // 更新乘机人信息
-    query.prepare("UPDATE passengers SET real_name = :realName, ID_card_number = :idCard, phone_number = :phone WHERE id = :id");
+    QSqlQuery &query = lease.prepared(SqlStatements::UpdatePassenger);
     query.bindValue(":realName", realName);
     query.bindValue(":idCard", idCard);
     query.bindValue(":phone", phone);
     query.bindValue(":id", passengerId);
 
-    if (query.exec()) {
-        resp["code"] = 200;
-        resp["msg"] = "更新成功";
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "更新失败: " + query.lastError().text();
-    }
-
-    return resp;
+    if (!query.exec())
+        return DbStatus::error(500, "更新失败: " + query.lastError().text());
+    return DbStatus::success("更新成功");
 }
 
-QJsonObject DbHandler::deletePassenger(const QString &passengerId, const QString &username)
+DbStatus DbHandler::deletePassenger(const QString &passengerId, const QString &username)
 {
-    QJsonObject resp;
-    QSqlDatabase db = getThreadSafeDb();
-    if (!db.isOpen()) {
-        resp["code"] = 500;
-        resp["msg"] = "数据库未连接";
-        return resp;
-    }
+    DbConnectionPool::Lease lease = acquireConnection();
+    QSqlDatabase db = lease.database();
+    if (!db.isOpen())
+        return notConnected();
 
     // 先验证该乘机人属于当前用户（防止越权删除）
-    QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM passengers WHERE id = :id AND username = :username");
-    query.bindValue(":id", passengerId);
-    query.bindValue(":username", username);
+    QSqlQuery &owned = lease.prepared(SqlStatements::CountPassengerOwned);
+    owned.bindValue(":id", passengerId);
+    owned.bindValue(":username", username);
 
-    if (query.exec() && query.next()) {
-        if (query.value(0).toInt() == 0) {
-            resp["code"] = 403;
-            resp["msg"] = "无权删除该乘机人信息";
-            return resp;
-        }
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "验证权限失败: " + query.lastError().text();
-        return resp;
-    }
+    if (!owned.exec() || !owned.next())
+        return DbStatus::error(500, "验证权限失败: " + owned.lastError().text());
+    if (owned.value(0).toInt() == 0)
+        return DbStatus::error(403, "无权删除该乘机人信息");
+    owned.finish();
 
     // 删除乘机人
-    query.prepare("DELETE FROM passengers WHERE id = :id");
+    QSqlQuery &query = lease.prepared(SqlStatements::DeletePassenger);
     query.bindValue(":id", passengerId);
 
-    if (query.exec()) {
-        resp["code"] = 200;
-        resp["msg"] = "删除成功";
-    } else {
-        resp["code"] = 500;
-        resp["msg"] = "删除失败: " + query.lastError().text();
-    }
-
-    return resp;
+    if (!query.exec())
+        return DbStatus::error(500, "删除失败: " + query.lastError().text());
+    return DbStatus::success("删除成功");
 }
@@ -8,7 +8,16 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QFuture>
+#include <QtConcurrent>
+#include <functional>
 #include "CommonDef.h"
+#include "DbConnectionPool.h"
+#include "SeatInventory.h"
+#include "FlightSearchCache.h"
+#include "BookedFlightIndex.h"
 
 class DbHandler : public QObject
 {
@@ -17,38 +26,137 @@ public:
     explicit DbHandler(QObject *parent = nullptr);
     ~DbHandler();
 
+    // 连接池参数，须在 connectDb 之前设置
+    void setPoolOptions(const DbConnectionPool::Options &options);
+    // 航班查询缓存的路线数上限（0 关闭）与航班目录校验间隔，须在 connectDb 之前设置
+    void setFlightCacheOptions(int maxEntries, int checkIntervalMs);
     bool connectDb(const QString &dsn, const QString &user, const QString &password);
     bool isConnected();
 
-    QJsonObject verifyUser(const QString &phone, const QString &password);
-    QJsonObject getUserInfo(const QString &username);
-    QJsonObject changePassword(const QString &username, const QString &oldPwd, const QString &newPwd);
+    // 在调用线程检出一个数据库连接；同一线程内嵌套检出复用同一连接，
+    // 组合请求在外层检出一次即可让所有子查询共用。超时返回无效租约
+    DbConnectionPool::Lease acquireConnection();
+    // 供主线程的启动、迁移、诊断查询使用：归还时连接迁出主线程，之后由数据库线程迁入复用
+    DbConnectionPool::Lease acquireStartupConnection();
 
-    QJsonObject registerUser(const QString &username, const QString &password,
-                             const QString &phone, const QString &idCard);
-    QJsonObject checkPhoneExists(const QString &phone);
-    QJsonObject checkIdCardExists(const QString &idCard);
+    // 数据库工作线程数，须在第一次异步调用前设置
+    void setWorkerThreadCount(int count);
+    // 等待已提交的异步调用全部结束
+    void waitForDone();
 
-    QJsonObject getFlightList(const QString &username, const QString &fromCity, const QString &toCity, const QString &date);
-    QJsonObject bookFlight(const QString &username, const QString &flightNum);
+    // 启动预热：在 count 个不同的数据库线程上各检出一个连接并预编译全部语句，
+    // 连接随之归属这些线程，之后的请求直接复用。返回预热成功的连接数
+    int warmUpConnections(int count);
 
-    QJsonObject getOrderListWithFlight(const QString &username);
-    QJsonObject refundOrder(const QString &orderNum, const QString &username);
-    QJsonObject getPassengers(const QString &username);
+    // 在数据库线程池中执行 function(args...)，调用线程只拿到 QFuture，不会阻塞在 ODBC 上。
+    // 可以传本类的成员函数（随后传 this），也可以传任意可调用对象，QFuture 的类型随其返回值
+    template <typename Function, typename... Args>
+    auto runAsync(Function &&function, Args &&...args)
+    {
+        return QtConcurrent::run(&m_pool, std::forward<Function>(function), std::forward<Args>(args)...);
+    }
 
-    QJsonObject addPassenger(const QString &username, const QString &realName,
-                             const QString &idCard, const QString &phone);
+    // 以下为各同步接口的异步版本，在数据库线程池中执行
+    QFuture<DbResult<UserData>> verifyUserAsync(const QString &phone, const QString &password)
+    { return runAsync(&DbHandler::verifyUser, this, phone, password); }
+    QFuture<DbResult<UserData>> getUserInfoAsync(const QString &username)
+    { return runAsync(&DbHandler::getUserInfo, this, username); }
+    QFuture<DbStatus> changePasswordAsync(const QString &username, const QString &oldPwd, const QString &newPwd)
+    { return runAsync(&DbHandler::changePassword, this, username, oldPwd, newPwd); }
+    QFuture<DbResult<UserData>> registerUserAsync(const QString &username, const QString &password,
+                                                  const QString &phone, const QString &idCard)
+    { return runAsync(&DbHandler::registerUser, this, username, password, phone, idCard); }
+    QFuture<DbResult<bool>> checkPhoneExistsAsync(const QString &phone)
+    { return runAsync(&DbHandler::checkPhoneExists, this, phone); }
+    QFuture<DbResult<bool>> checkIdCardExistsAsync(const QString &idCard)
+    { return runAsync(&DbHandler::checkIdCardExists, this, idCard); }
+    QFuture<DbResult<Page<FlightData>>> getFlightListAsync(const QString &username, const QString &fromCity,
+                                                           const QString &toCity, const QString &date,
+                                                           const PageRequest<FlightData> &page = {})
+    { return runAsync(&DbHandler::getFlightList, this, username, fromCity, toCity, date, page); }
+    QFuture<DbResult<BookingData>> bookFlightAsync(const QString &username, const QString &flightNum,
+                                                   const QString &seatPreference = QString())
+    { return runAsync(&DbHandler::bookFlight, this, username, flightNum, seatPreference); }
+    QFuture<DbResult<SeatMapData>> getSeatMapAsync(const QString &flightNum)
+    { return runAsync(&DbHandler::getSeatMap, this, flightNum); }
+    QFuture<DbResult<Page<OrderData>>> getOrderListWithFlightAsync(const QString &username,
+                                                                   const PageRequest<OrderData> &page = {})
+    { return runAsync(&DbHandler::getOrderListWithFlight, this, username, page); }
+    QFuture<DbStatus> refundOrderAsync(const QString &orderNum, const QString &username)
+    { return runAsync(&DbHandler::refundOrder, this, orderNum, username); }
+    QFuture<DbResult<QVector<PassengerData>>> getPassengersAsync(const QString &username)
+    { return runAsync(&DbHandler::getPassengers, this, username); }
+    QFuture<DbStatus> addPassengerAsync(const QString &username, const QString &realName,
+                                        const QString &idCard, const QString &phone)
+    { return runAsync(&DbHandler::addPassenger, this, username, realName, idCard, phone); }
+    QFuture<DbStatus> updatePassengerAsync(const QString &passengerId, const QString &username,
+                                           const QString &realName, const QString &idCard, const QString &phone)
+    { return runAsync(&DbHandler::updatePassenger, this, passengerId, username, realName, idCard, phone); }
+    QFuture<DbStatus> deletePassengerAsync(const QString &passengerId, const QString &username)
+    { return runAsync(&DbHandler::deletePassenger, this, passengerId, username); }
 
-    QJsonObject updatePassenger(const QString &passengerId, const QString &username,
-                                const QString &realName, const QString &idCard, const QString &phone);
-    QJsonObject deletePassenger(const QString &passengerId, const QString &username);
-    QSqlDatabase getDb() const { return m_db; }
+    // 以下接口返回 CommonDef 中的记录或状态，结果行按列位置映射，回复格式由调用方在连接边界生成
+    DbResult<UserData> verifyUser(const QString &phone, const QString &password);
+    DbResult<UserData> getUserInfo(const QString &username);
+    DbStatus changePassword(const QString &username, const QString &oldPwd, const QString &newPwd);
+
+    // 成功时只填 username 与 phone
+    DbResult<UserData> registerUser(const QString &username, const QString &password,
+                                    const QString &phone, const QString &idCard);
+    DbResult<bool> checkPhoneExists(const QString &phone);
+    DbResult<bool> checkIdCardExists(const QString &idCard);
+
+    // 分页按航班 id，remaining 与 is_booked 为回复时的最新值
+    DbResult<Page<FlightData>> getFlightList(const QString &username, const QString &fromCity,
+                                             const QString &toCity, const QString &date,
+                                             const PageRequest<FlightData> &page = {});
+    // seatPreference 为 window/aisle/middle，空表示不限
+    DbResult<BookingData> bookFlight(const QString &username, const QString &flightNum,
+                                     const QString &seatPreference = QString());
+    DbResult<SeatMapData> getSeatMap(const QString &flightNum);
+
+    // 按下单时间倒序分页，其余同 getFlightList
+    DbResult<Page<OrderData>> getOrderListWithFlight(const QString &username,
+                                                     const PageRequest<OrderData> &page = {});
+    DbStatus refundOrder(const QString &orderNum, const QString &username);
+    DbResult<QVector<PassengerData>> getPassengers(const QString &username);
+
+    DbStatus addPassenger(const QString &username, const QString &realName,
+                          const QString &idCard, const QString &phone);
+
+    DbStatus updatePassenger(const QString &passengerId, const QString &username,
+                             const QString &realName, const QString &idCard, const QString &phone);
+    DbStatus deletePassenger(const QString &passengerId, const QString &username);
 private:
-    QSqlDatabase getThreadSafeDb();
-    QSqlDatabase m_db;
-    QString m_dsn;
-    QString m_user;
-    QString m_password;
+    // 余票变化后把内存中的最新值发布给订阅了该航线的连接
+    void publishRemaining(const SeatInventory::Flight *flight);
+    // 航班不在内存余票表中时（启动后新增的航班）从数据库补载
+    SeatInventory::Flight *findFlight(DbConnectionPool::Lease &lease, const QString &flightNum);
+    SeatInventory::Flight *findFlight(DbConnectionPool::Lease &lease, int flightId);
+    // 从已执行的航班查询载入，座位图建好后才发布
+    SeatInventory::Flight *loadFlight(DbConnectionPool::Lease &lease, QSqlQuery &query);
+    // 在余票写线程中执行，一个事务写入一批余票变化
+    bool persistSeatDeltas(const QList<SeatInventory::Delta> &deltas);
+    // 在 count 个不同的数据库线程上各执行一次 task：每个任务等全部到齐才结束，同一线程不会领到两个。
+    // 返回 task 返回 true 的次数
+    int runOnEachThread(int count, const std::function<bool()> &task);
+    // 计算航班目录校验值，发现外部改动时清空查询缓存
+    void checkFlightCatalog();
+    // 用户有效订单涉及的航班，未缓存时用 lease 从 orders 载入
+    QSet<int> bookedFlights(DbConnectionPool::Lease &lease, const QString &username);
+
+    DbConnectionPool::Options m_poolOptions;
+    DbConnectionPool *m_connectionPool = nullptr;
+    QTimer *m_reapTimer;
+    bool m_connected = false;
+    SeatInventory m_inventory;
+    FlightSearchCache m_flightCache;
+    BookedFlightIndex m_bookedFlights;
+    int m_flightCacheCheckMs = 5000;
+    QTimer *m_catalogTimer;
+
+    // 数据库工作线程，每次查询从连接池检出连接；连接归还后仍属于检出它的线程
+    QThreadPool m_pool;
 };
 
 #endif // DBHANDLER_H
@@ -0,0 +1,181 @@
+#include "EncoderBench.h"
+#include "Reply.h"
+#include "FrameDecoder.h"
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QDebug>
+
+// 原来的做法：每行一个 QJsonObject，放进 QJsonArray 后整体序列化
+static QJsonObject flightTree(const FlightData &flight)
+{
+    return QJsonObject{
+        {"flight_number", flight.flight_num},
+        {"airline", flight.airline},
+        {"startCity", flight.from_city},
+        {"endCity", flight.to_city},
+        {"startAirport", flight.from_airport},
+        {"endAirport", flight.to_airport},
+        {"startDate", flight.date},
+        {"endDate", flight.date},
+        {"startTime", flight.depart_time},
+        {"endTime", flight.arrive_time},
+        {"price", flight.price},
+        {"status", flight.remaining > 0 ? "有票" : "售罄"},
+        {"isBooked", flight.is_booked}
+    };
+}
+
+static QVector<FlightData> sampleFlights(int rows)
+{
+    static const char *const cities[] = {"北京", "上海", "广州", "深圳", "成都", "西安"};
+    QVector<FlightData> flights;
+    flights.reserve(rows);
+    for (int i = 0; i < rows; ++i) {
+        FlightData flight;
+        flight.id = i + 1;
+        flight.flight_num = QString("CA%1").arg(1000 + i);
+        flight.airline = "中国国际航空";
+        flight.from_city = cities[i % 6];
+        flight.to_city = cities[(i + 1) % 6];
+        flight.from_airport = flight.from_city + "首都国际机场";
+        flight.to_airport = flight.to_city + "国际机场";
+        flight.date = "2025-06-18";
+        flight.depart_time = QString("%1:%2").arg(6 + i % 16, 2, 10, QChar('0')).arg(i % 60, 2, 10, QChar('0'));
+        flight.arrive_time = QString("%1:%2").arg(8 + i % 16, 2, 10, QChar('0')).arg(i % 60, 2, 10, QChar('0'));
+        flight.price = QString::number(600 + i % 900) + ".00";
+        flight.remaining = i % 7;
+        flight.is_booked = i % 11 == 0;
+        flights.append(flight);
+    }
+    return flights;
+}
+
+static QJsonObject envelope(int rows)
+{
+    return QJsonObject{
+        {"type", "get_flights_reply"},
+        {"success", true},
+        {"count", rows},
+        {"req_id", 42}
+    };
+}
+
+// 返回每次编码的平均微秒数；out 保留最后一次的帧
+template <typename Encode>
+static double measure(int iterations, QByteArray &out, Encode encode)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        out.resize(0);
+        encode(out);
+    }
+    return double(timer.nsecsElapsed()) / 1000.0 / iterations;
+}
+
+int EncoderBench::run(int rows, int iterations)
+{
+    rows = qMax(1, rows);
+    iterations = qMax(1, iterations);
+    const QVector<FlightData> flights = sampleFlights(rows);
+    bool consistent = true;
+
+    qInfo().noquote() << QString("编码基准：%1 行，%2 次").arg(rows).arg(iterations);
+    for (NetworkUtils::WireFormat format : {NetworkUtils::Json, NetworkUtils::Cbor}) {
+        QByteArray treeFrame;
+        const double treeUs = measure(iterations, treeFrame, [&](QByteArray &out) {
+            QJsonArray array;
+            for (const FlightData &flight : flights)
+                array.append(flightTree(flight));
+            QJsonObject resp = envelope(rows);
+            resp["data"] = array;
+            NetworkUtils::appendFrame(out, resp, format);
+        });
+
+        QByteArray directFrame;
+        const double directUs = measure(iterations, directFrame, [&](QByteArray &out) {
+            // 与处理函数相同：行按值交给 RowSet，编码时直接写出
+            Reply(envelope(rows), makeRowSet(flights)).appendFrame(out, format);
+        });
+
+        qInfo().noquote() << QString("  %1  JSON 树 %2 us / %3 字节，直接编码 %4 us / %5 字节，%6x")
+                                 .arg(NetworkUtils::formatName(format), -4)
+                                 .arg(treeUs, 0, 'f', 1).arg(treeFrame.size())
+                                 .arg(directUs, 0, 'f', 1).arg(directFrame.size())
+                                 .arg(directUs > 0 ? treeUs / directUs : 0.0, 0, 'f', 2);
+
+        // 两条路径解码后应得到同一个对象（键顺序可以不同）
+        QJsonObject treeJson, directJson;
+        const qsizetype header = 2 * sizeof(quint32);
+        if (!NetworkUtils::decodePayload(treeFrame.mid(header), format, treeJson)
+            || !NetworkUtils::decodePayload(directFrame.mid(header), format, directJson)
+            || treeJson != directJson) {
+            qWarning() << "  两种编码结果不一致：" << NetworkUtils::formatName(format);
+            consistent = false;
+        }
+    }
+    return consistent ? 0 : 1;
+}
+
+int EncoderBench::runFormats(int rows, int iterations)
+{
+    rows = qMax(1, rows);
+    iterations = qMax(1, iterations);
+    const QVector<FlightData> flights = sampleFlights(rows);
+
+    struct Result {
+        double encodeUs = 0;
+        double decodeUs = 0;
+        qsizetype bytes = 0;
+        QJsonObject decoded;
+    };
+    Result results[2];
+    const NetworkUtils::WireFormat formats[] = {NetworkUtils::Json, NetworkUtils::Cbor};
+
+    qInfo().noquote() << QString("编码格式基准：get_flights 回复 %1 行，%2 次").arg(rows).arg(iterations);
+    for (int i = 0; i < 2; ++i) {
+        const NetworkUtils::WireFormat format = formats[i];
+        Result &result = results[i];
+
+        QByteArray frame;
+        result.encodeUs = measure(iterations, frame, [&](QByteArray &out) {
+            Reply(envelope(rows), makeRowSet(flights)).appendFrame(out, format);
+        });
+        result.bytes = frame.size();
+
+        // 客户端一侧：收到整帧后分帧，再把载荷解析成对象
+        QElapsedTimer timer;
+        timer.start();
+        for (int n = 0; n < iterations; ++n) {
+            FrameDecoder decoder(quint32(frame.size()));
+            decoder.append(frame);
+            QByteArray payload;
+            if (decoder.next(payload) != FrameDecoder::FrameReady
+                || !NetworkUtils::decodePayload(payload, format, result.decoded)) {
+                qWarning() << "  解码失败：" << NetworkUtils::formatName(format);
+                return 1;
+            }
+        }
+        result.decodeUs = double(timer.nsecsElapsed()) / 1000.0 / iterations;
+
+        qInfo().noquote() << QString("  %1  编码 %2 us，解码 %3 us，%4 字节")
+                                 .arg(NetworkUtils::formatName(format), -4)
+                                 .arg(result.encodeUs, 0, 'f', 1)
+                                 .arg(result.decodeUs, 0, 'f', 1)
+                                 .arg(result.bytes);
+    }
+
+    const Result &json = results[0];
+    const Result &cbor = results[1];
+    qInfo().noquote() << QString("  CBOR / JSON：编码 %1%，解码 %2%，大小 %3%")
+                             .arg(json.encodeUs > 0 ? 100.0 * cbor.encodeUs / json.encodeUs : 0.0, 0, 'f', 1)
+                             .arg(json.decodeUs > 0 ? 100.0 * cbor.decodeUs / json.decodeUs : 0.0, 0, 'f', 1)
+                             .arg(100.0 * double(cbor.bytes) / double(json.bytes), 0, 'f', 1);
+
+    // 两种编码应一一对应，解出同一个对象
+    if (json.decoded != cbor.decoded) {
+        qWarning() << "  JSON 与 CBOR 解出的回复不一致";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef ENCODERBENCH_H
+#define ENCODERBENCH_H
+
+// 回复编码的微基准：同一组航班行分别经 JSON 树（QJsonObject/QJsonArray 再序列化）
+// 和 WireEncoder 直接写帧，按 JSON、CBOR 两种编码比较单次耗时与帧大小。
+// 不连接数据库，由 --bench-encoder 启动，结果打印到日志后退出
+class EncoderBench
+{
+public:
+    // 返回进程退出码，两条路径的 JSON 结果不一致时返回 1
+    static int run(int rows, int iterations);
+
+    // 同一个 get_flights 回复分别按 JSON、CBOR 编码，比较帧大小、服务端编码耗时
+    // 和收到整帧后分帧加解析的耗时。由 --bench-formats 启动，两种编码解出的对象不一致时返回 1
+    static int runFormats(int rows, int iterations);
+};
+
+#endif // ENCODERBENCH_H
@@ -0,0 +1,654 @@
+#include "EpollReactor.h"
+
+#ifdef Q_OS_LINUX
+
+#include "FrameDecoder.h"
+#include "ConnectionTimeouts.h"
+#include "LogCategories.h"
+#include "NetworkUtils.h"
+#include "ServerStats.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QDebug>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+// epoll 事件中的 data.u64：0 表示唤醒用的 eventfd，其余为连接编号
+static constexpr quint64 kMailboxKey = 0;
+static constexpr int kMaxEvents = 256;
+// 每次 read 的缓冲大小，与 Qt 后端的套接字读缓冲上限一致
+static constexpr qsizetype kReadChunkSize = 64 * 1024;
+
+struct EpollReactor::Connection
+{
+    Connection(quint64 id, int fd, const ServerConfig &config, TimerWheel *timerWheel)
+        : id(id), fd(fd), decoder(config.maxFrameSize), timeouts(config, timerWheel) {}
+
+    qint64 pendingWriteBytes() const { return out.size() - outPos; }
+
+    quint64 id;
+    int fd;
+    FrameDecoder decoder;
+    ConnectionTimeouts timeouts;
+    NetworkUtils::WireFormat format = NetworkUtils::Json;
+
+    QByteArray out;                 // 待发送数据，outPos 之前的部分已写出
+    qsizetype outPos = 0;
+
+    // 不带 req_id 的请求逐个执行，保证回复顺序与请求顺序一致
+    QQueue<QJsonObject> orderedRequests;
+    bool orderedRunning = false;
+
+    QList<std::shared_ptr<ReplyStream>> streams;        // 进行中的流式回复
+    QList<std::shared_ptr<ReplyStream>> stalledStreams; // 等发送缓冲降到低水位后再确认
+
+    bool readPaused = false;        // 待发送数据超过高水位或排队请求过多，暂停读取
+    bool readPending = false;       // 暂停期间内核中可能还有数据（边沿触发不会再次通知）
+    bool dirty = false;             // 已在 m_dirty 中
+    bool closed = false;
+    quint64 subscriberId = 0;
+};
+
+struct EpollReactor::Mailbox
+{
+    struct Completion {
+        quint64 connectionId;
+        Reply reply;
+        bool ordered;               // 顺序请求完成后要接着执行该连接的下一个
+        std::shared_ptr<ReplyStream> stream;    // 流式回复；chunk 为 true 时 reply 是其中一块
+        bool chunk = false;
+    };
+
+    ~Mailbox()
+    {
+        if (eventFd >= 0)
+            ::close(eventFd);
+    }
+
+    void wake()
+    {
+        const quint64 one = 1;
+        if (::write(eventFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+            qWarning() << "唤醒反应器失败：" << strerror(errno);
+    }
+
+    void postConnection(int fd)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            connections.append(fd);
+        }
+        wake();
+    }
+
+    void postCompletion(quint64 connectionId, const Reply &reply, bool ordered,
+                        const std::shared_ptr<ReplyStream> &stream = nullptr)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            completions.append({connectionId, reply, ordered, stream, false});
+        }
+        wake();
+    }
+
+    // 与结束帧共用一个队列，分块一定先于结束帧送到
+    void postChunk(quint64 connectionId, const std::shared_ptr<ReplyStream> &stream, const Reply &frame)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            completions.append({connectionId, frame, false, stream, true});
+        }
+        wake();
+    }
+
+    QMutex mutex;
+    QList<int> connections;
+    QList<Completion> completions;
+    int eventFd = -1;
+};
+
+EpollReactor::EpollReactor(int index, const ServerConfig &config, RequestDispatcher *dispatcher)
+    : m_index(index), m_config(config), m_dispatcher(dispatcher),
+      m_mailbox(std::make_shared<Mailbox>()), m_timerWheel(config.timerTickMs),
+      m_subscriptions([mailbox = m_mailbox]() { mailbox->wake(); })
+{
+    setObjectName(QString("epoll_reactor_%1").arg(index));
+}
+
+EpollReactor::~EpollReactor()
+{
+    // 线程已退出；未被接管的套接字在这里关闭
+    for (int fd : std::as_const(m_mailbox->connections)) {
+        ::close(fd);
+        ServerStats::instance().connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+    }
+    m_mailbox->connections.clear();
+    if (m_epollFd >= 0)
+        ::close(m_epollFd);
+}
+
+bool EpollReactor::init()
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        qWarning() << "epoll_create1 失败：" << strerror(errno);
+        return false;
+    }
+
+    m_mailbox->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_mailbox->eventFd < 0) {
+        qWarning() << "eventfd 失败：" << strerror(errno);
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = kMailboxKey;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_mailbox->eventFd, &ev) < 0) {
+        qWarning() << "注册 eventfd 失败：" << strerror(errno);
+        return false;
+    }
+
+    m_readBuffer.resize(kReadChunkSize);
+    return true;
+}
+
+void EpollReactor::addConnection(qintptr socketDescriptor)
+{
+    // 立即计数，接收线程挑选反应器时能看到尚未接管的连接
+    m_connectionCount.fetch_add(1, std::memory_order_relaxed);
+    m_mailbox->postConnection(int(socketDescriptor));
+}
+
+void EpollReactor::requestStop()
+{
+    m_stopping.store(true, std::memory_order_release);
+    m_mailbox->wake();
+}
+
+void EpollReactor::run()
+{
+    epoll_event events[kMaxEvents];
+
+    while (!m_stopping.load(std::memory_order_acquire)) {
+        // 最长等待一个刻度，保证时间轮按时推进
+        const int n = epoll_wait(m_epollFd, events, kMaxEvents, m_timerWheel.tickMs());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            qWarning() << "epoll_wait 失败：" << strerror(errno);
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const quint64 key = events[i].data.u64;
+            if (key == kMailboxKey) {
+                drainMailbox();
+                continue;
+            }
+
+            // 同一批事件中靠前的事件可能已关闭该连接
+            Connection *conn = m_connections.value(key);
+            if (!conn)
+                continue;
+
+            const uint32_t flags = events[i].events;
+            if (flags & EPOLLERR) {
+                closeConnection(conn);
+                continue;
+            }
+            if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+                onReadable(conn);
+            if (!conn->closed && (flags & EPOLLOUT))
+                onWritable(conn);
+        }
+
+        m_timerWheel.advance(m_timerWheel.now());
+        m_subscriptions.drain();
+        flushDirty();
+
+        qDeleteAll(m_closed);
+        m_closed.clear();
+    }
+
+    // 退出前关闭本线程的所有连接，取消它们在时间轮中的定时器
+    const QList<Connection *> remaining = m_connections.values();
+    for (Connection *conn : remaining)
+        closeConnection(conn);
+    qDeleteAll(m_closed);
+    m_closed.clear();
+}
+
+void EpollReactor::drainMailbox()
+{
+    quint64 counter;
+    while (::read(m_mailbox->eventFd, &counter, sizeof(counter)) > 0) {}
+
+    QList<int> connections;
+    QList<Mailbox::Completion> completions;
+    {
+        QMutexLocker locker(&m_mailbox->mutex);
+        connections.swap(m_mailbox->connections);
+        completions.swap(m_mailbox->completions);
+    }
+
+    for (int fd : std::as_const(connections))
+        openConnection(fd);
+
+    for (Mailbox::Completion &completion : completions) {
+        Connection *conn = m_connections.value(completion.connectionId);
+        if (!conn) {
+            // 请求完成前连接已关闭，丢弃回复并让仍在推送的生产者停止
+            if (completion.stream)
+                completion.stream->cancel();
+            continue;
+        }
+        if (completion.chunk) {
+            onStreamChunk(conn, completion.stream, completion.reply);
+            continue;
+        }
+        if (completion.stream)
+            closeStream(conn, completion.stream);
+        send(conn, completion.reply);
+        checkBackpressure(conn);
+        if (completion.ordered && !conn->closed) {
+            conn->orderedRunning = false;
+            runOrderedRequests(conn);
+            maybeResumeReading(conn);
+        }
+    }
+}
+
+void EpollReactor::openConnection(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        qWarning() << "设置非阻塞失败：" << strerror(errno);
+        ::close(fd);
+        m_connectionCount.fetch_sub(1, std::memory_order_relaxed);
+        ServerStats::instance().connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // 回复已按事件循环批量写出，关闭 Nagle 避免小包被额外延迟
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (m_config.socketSendBufferSize > 0)
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &m_config.socketSendBufferSize, sizeof(int));
+    if (m_config.socketReceiveBufferSize > 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &m_config.socketReceiveBufferSize, sizeof(int));
+
+    Connection *conn = new Connection(m_nextId++, fd, m_config, &m_timerWheel);
+
+    // 读写事件一次注册，边沿触发下可写事件只在发送缓冲由满变空时通知
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.u64 = conn->id;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        qWarning() << "注册连接失败：" << strerror(errno);
+        ::close(fd);
+        delete conn;
+        m_connectionCount.fetch_sub(1, std::memory_order_relaxed);
+        ServerStats::instance().connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_connections.insert(conn->id, conn);
+    const quint64 id = conn->id;
+    conn->timeouts.start([this, id]() { onTimer(id); });
+    conn->subscriberId = m_subscriptions.addSubscriber([this, id](const QJsonObject &frame) {
+        if (Connection *target = m_connections.value(id)) {
+            send(target, frame);
+            checkBackpressure(target);
+        }
+    });
+
+    qDebug() << "反应器" << m_index << "接管连接：" << fd << "当前连接数：" << connectionCount();
+
+    // 注册前到达的数据不会再产生边沿，直接读一次
+    onReadable(conn);
+}
+
+void EpollReactor::closeConnection(Connection *conn)
+{
+    if (conn->closed)
+        return;
+    conn->closed = true;
+
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    ::close(conn->fd);
+    m_connections.remove(conn->id);
+    m_subscriptions.removeSubscriber(conn->subscriberId);
+    for (const std::shared_ptr<ReplyStream> &stream : std::as_const(conn->streams))
+        stream->cancel();
+    conn->streams.clear();
+    conn->stalledStreams.clear();
+    // 本轮事件中可能仍持有该指针，释放推迟到本轮结束
+    m_closed.append(conn);
+
+    m_connectionCount.fetch_sub(1, std::memory_order_relaxed);
+    ServerStats::instance().connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void EpollReactor::onReadable(Connection *conn)
+{
+    conn->timeouts.touch();
+
+    // 待发送数据过多时不再读取，数据留在内核中由 TCP 窗口施加反压
+    if (conn->readPaused) {
+        conn->readPending = true;
+        return;
+    }
+    conn->readPending = false;
+
+    // 边沿触发：必须一直读到 EAGAIN，否则不会再收到通知
+    for (;;) {
+        const ssize_t n = ::read(conn->fd, m_readBuffer.data(), size_t(m_readBuffer.size()));
+        if (n > 0) {
+            conn->decoder.append(QByteArray::fromRawData(m_readBuffer.constData(), qsizetype(n)));
+            processFrames(conn);
+            if (conn->closed)
+                return;
+            if (conn->readPaused) {
+                conn->readPending = true;
+                break;
+            }
+            continue;
+        }
+        if (n == 0) {
+            closeConnection(conn);     // 对端关闭
+            return;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        qDebug() << "读取失败，关闭连接：" << conn->fd << strerror(errno);
+        closeConnection(conn);
+        return;
+    }
+
+    // 只在等待客户端补齐数据时计半包超时，因反压暂停时不计
+    conn->timeouts.setPartialFrame(!conn->readPaused
+                                   && (conn->decoder.bufferedBytes() > 0 || conn->decoder.isSkipping()));
+}
+
+void EpollReactor::processFrames(Connection *conn)
+{
+    // 一次取完缓冲区中所有完整帧，客户端可以流水线发送请求
+    QByteArray payload;
+    while (!conn->readPaused && !conn->closed) {
+        FrameDecoder::Status status = conn->decoder.next(payload);
+        if (status == FrameDecoder::NeedMore)
+            break;
+        if (status == FrameDecoder::FrameTooLarge) {
+            qWarning() << "数据帧超过上限" << conn->decoder.maxFrameSize() << "字节，已丢弃";
+            QJsonObject resp;
+            resp["type"] = "error";
+            resp["success"] = false;
+            resp["message"] = "数据帧过大";
+            resp["max_frame_size"] = qint64(conn->decoder.maxFrameSize());
+            send(conn, resp);
+            continue;
+        }
+        if (status == FrameDecoder::Malformed) {
+            qWarning() << "收到格式错误的数据帧";
+            continue;
+        }
+
+        QJsonObject json;
+        if (NetworkUtils::decodePayload(payload, conn->format, json)) {
+            qCDebug(lcRequests) << "收到前端请求：" << json;
+            processRequest(conn, json);
+            checkBackpressure(conn);
+        }
+    }
+}
+
+void EpollReactor::processRequest(Connection *conn, const QJsonObject &request)
+{
+    QJsonObject reply;
+    NetworkUtils::WireFormat nextFormat;
+    if (NetworkUtils::handleControlMessage(request, conn->format, reply, nextFormat)) {
+        // 回复仍使用旧编码，之后双方都切换到新编码
+        if (!reply.isEmpty())
+            send(conn, reply);
+        conn->format = nextFormat;
+        return;
+    }
+
+    if (m_subscriptions.handleRequest(conn->subscriberId, request, reply)) {
+        send(conn, reply);
+        return;
+    }
+
+    const QJsonValue reqId = request.value("req_id");
+    if (reqId.isUndefined()) {
+        conn->orderedRequests.enqueue(request);
+        runOrderedRequests(conn);
+        return;
+    }
+
+    if (!m_dispatcher->tryBeginRequest()) {
+        QJsonObject resp = RequestDispatcher::serverBusyReply("requests", m_dispatcher->busyRetryAfterMs());
+        resp["req_id"] = reqId;
+        send(conn, resp);
+        return;
+    }
+
+    if (m_dispatcher->runsInline(request)) {
+        QJsonObject resp = m_dispatcher->dispatch(request);
+        m_dispatcher->endRequest();
+        resp["req_id"] = reqId;
+        send(conn, resp);
+        return;
+    }
+
+    // 结果在数据库线程中投递回本反应器，按连接编号找回连接
+    std::shared_ptr<Mailbox> mailbox = m_mailbox;
+    const quint64 id = conn->id;
+    std::shared_ptr<ReplyStream> stream;
+    if (m_dispatcher->wantsStream(request))
+        stream = openStream(conn, reqId);
+    m_dispatcher->dispatchAsync(request, stream).then([mailbox, id, reqId, stream](Reply resp) {
+        resp.json["req_id"] = reqId;
+        mailbox->postCompletion(id, resp, false, stream);
+    });
+}
+
+void EpollReactor::runOrderedRequests(Connection *conn)
+{
+    while (!conn->orderedRunning && !conn->orderedRequests.isEmpty()) {
+        const QJsonObject request = conn->orderedRequests.dequeue();
+
+        if (!m_dispatcher->tryBeginRequest()) {
+            send(conn, RequestDispatcher::serverBusyReply("requests", m_dispatcher->busyRetryAfterMs()));
+            continue;
+        }
+
+        if (m_dispatcher->runsInline(request)) {
+            QJsonObject resp = m_dispatcher->dispatch(request);
+            m_dispatcher->endRequest();
+            send(conn, resp);
+            continue;
+        }
+
+        conn->orderedRunning = true;
+        std::shared_ptr<Mailbox> mailbox = m_mailbox;
+        const quint64 id = conn->id;
+        std::shared_ptr<ReplyStream> stream;
+        if (m_dispatcher->wantsStream(request))
+            stream = openStream(conn, QJsonValue(QJsonValue::Undefined));
+        m_dispatcher->dispatchAsync(request, stream).then([mailbox, id, stream](const Reply &resp) {
+            mailbox->postCompletion(id, resp, true, stream);
+        });
+    }
+}
+
+void EpollReactor::send(Connection *conn, const Reply &reply)
+{
+    if (conn->closed)
+        return;
+    reply.appendFrame(conn->out, conn->format);
+    if (!conn->dirty) {
+        conn->dirty = true;
+        m_dirty.append(conn->id);
+    }
+}
+
+void EpollReactor::flushDirty()
+{
+    // flush 可能恢复读取并产生新回复，逐轮处理直到没有新的待写连接
+    while (!m_dirty.isEmpty()) {
+        QList<quint64> dirty;
+        dirty.swap(m_dirty);
+        for (quint64 id : std::as_const(dirty)) {
+            Connection *conn = m_connections.value(id);
+            if (!conn)
+                continue;
+            conn->dirty = false;
+            flush(conn);
+        }
+    }
+}
+
+void EpollReactor::onWritable(Connection *conn)
+{
+    if (conn->pendingWriteBytes() > 0)
+        flush(conn);
+}
+
+void EpollReactor::flush(Connection *conn)
+{
+    while (conn->pendingWriteBytes() > 0) {
+        const ssize_t n = ::send(conn->fd, conn->out.constData() + conn->outPos,
+                                 size_t(conn->pendingWriteBytes()), MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->outPos += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;      // 内核发送缓冲已满，等待 EPOLLOUT
+        qDebug() << "写入失败，关闭连接：" << conn->fd << strerror(errno);
+        closeConnection(conn);
+        return;
+    }
+
+    if (conn->pendingWriteBytes() == 0) {
+        conn->out.resize(0);
+        conn->outPos = 0;
+    } else if (conn->outPos >= conn->out.size() / 2) {
+        // 已写出的部分过半时再整理，避免每次部分写都搬移数据
+        conn->out.remove(0, conn->outPos);
+        conn->outPos = 0;
+    }
+
+    releaseStalledStreams(conn);
+    maybeResumeReading(conn);
+}
+
+void EpollReactor::maybeResumeReading(Connection *conn)
+{
+    if (conn->closed || !conn->readPaused)
+        return;
+    if (conn->pendingWriteBytes() > m_config.writeLowWaterMark
+        || conn->orderedRequests.size() >= m_config.maxQueuedRequests)
+        return;
+
+    conn->readPaused = false;
+    qDebug() << "待发送数据已降至低水位，恢复读取";
+    // 处理暂停期间留在解码器和内核中的请求
+    processFrames(conn);
+    if (!conn->closed && !conn->readPaused)
+        onReadable(conn);
+}
+
+void EpollReactor::checkBackpressure(Connection *conn)
+{
+    if (conn->closed)
+        return;
+    const qint64 pending = conn->pendingWriteBytes();
+    if (pending > m_config.maxPendingWriteBytes) {
+        qWarning() << "客户端读取过慢，待发送" << pending << "字节，断开连接";
+        closeConnection(conn);
+        return;
+    }
+    if (!conn->readPaused && pending > m_config.writeHighWaterMark) {
+        conn->readPaused = true;
+        qDebug() << "待发送数据超过高水位" << pending << "字节，暂停读取";
+    }
+    if (!conn->readPaused && conn->orderedRequests.size() >= m_config.maxQueuedRequests) {
+        conn->readPaused = true;
+        qDebug() << "排队请求达到" << conn->orderedRequests.size() << "个，暂停读取";
+    }
+}
+
+std::shared_ptr<ReplyStream> EpollReactor::openStream(Connection *conn, const QJsonValue &reqId)
+{
+    // 分块经邮箱投递，连接关闭后邮箱仍有效，由 drainMailbox 取消生产者
+    std::shared_ptr<Mailbox> mailbox = m_mailbox;
+    const quint64 id = conn->id;
+    auto stream = std::make_shared<ReplyStream>(reqId, [mailbox, id](const std::shared_ptr<ReplyStream> &target,
+                                                                     const Reply &frame) {
+        mailbox->postChunk(id, target, frame);
+    });
+    conn->streams.append(stream);
+    return stream;
+}
+
+void EpollReactor::onStreamChunk(Connection *conn, const std::shared_ptr<ReplyStream> &stream,
+                                 const Reply &frame)
+{
+    send(conn, frame);
+    checkBackpressure(conn);
+    if (conn->closed)
+        return;
+    if (conn->pendingWriteBytes() > m_config.writeHighWaterMark)
+        conn->stalledStreams.append(stream);
+    else
+        stream->delivered();
+}
+
+void EpollReactor::closeStream(Connection *conn, const std::shared_ptr<ReplyStream> &stream)
+{
+    conn->streams.removeOne(stream);
+    conn->stalledStreams.removeOne(stream);
+}
+
+void EpollReactor::releaseStalledStreams(Connection *conn)
+{
+    if (conn->closed || conn->stalledStreams.isEmpty()
+        || conn->pendingWriteBytes() > m_config.writeLowWaterMark)
+        return;
+    for (const std::shared_ptr<ReplyStream> &stream : std::as_const(conn->stalledStreams))
+        stream->delivered();
+    conn->stalledStreams.clear();
+}
+
+void EpollReactor::onTimer(quint64 connectionId)
+{
+    Connection *conn = m_connections.value(connectionId);
+    if (!conn)
+        return;
+
+    const ConnectionTimeouts::Action action = conn->timeouts.expire();
+    if (action == ConnectionTimeouts::SendPing) {
+        send(conn, QJsonObject{{"type", "ping"}});
+    } else if (action != ConnectionTimeouts::None) {
+        qInfo() << "回收连接：" << conn->fd << ConnectionTimeouts::reasonText(action);
+        ServerStats::instance().connectionsReaped.fetch_add(1, std::memory_order_relaxed);
+        closeConnection(conn);
+    }
+}
+
+#endif // Q_OS_LINUX
@@ -0,0 +1,95 @@
+#ifndef EPOLLREACTOR_H
+#define EPOLLREACTOR_H
+
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+
+#include <QThread>
+#include <QHash>
+#include <QList>
+#include <QJsonObject>
+#include <atomic>
+#include <memory>
+#include "RequestDispatcher.h"
+#include "ServerConfig.h"
+#include "TimerWheel.h"
+#include "SubscriptionHub.h"
+#include "ReplyStream.h"
+
+// Linux 下可选的 I/O 后端：每个线程一个边沿触发的 epoll 反应器，直接读写非阻塞套接字，
+// 不经过 QTcpSocket 的信号槽。分帧、控制消息、准入、反压与超时规则和 ClientHandler 一致
+class EpollReactor : public QThread
+{
+public:
+    explicit EpollReactor(int index, const ServerConfig &config, RequestDispatcher *dispatcher);
+    ~EpollReactor();
+
+    // 创建 epoll 与唤醒用的 eventfd，失败返回 false
+    bool init();
+
+    // 线程安全：把已接受的套接字交给本反应器
+    void addConnection(qintptr socketDescriptor);
+
+    // 线程安全：通知事件循环关闭所有连接并退出，之后由调用方 wait()
+    void requestStop();
+
+    int index() const { return m_index; }
+    int connectionCount() const { return m_connectionCount.load(std::memory_order_relaxed); }
+
+protected:
+    void run() override;
+
+private:
+    struct Connection;
+    struct Mailbox;
+
+    void drainMailbox();
+    void openConnection(int fd);
+    void closeConnection(Connection *conn);
+
+    void onReadable(Connection *conn);
+    void onWritable(Connection *conn);
+    void processFrames(Connection *conn);
+    void processRequest(Connection *conn, const QJsonObject &request);
+    // 逐个执行排队的顺序请求，上一个完成后才开始下一个
+    void runOrderedRequests(Connection *conn);
+
+    // 回复先追加到连接的发送缓冲，本轮事件处理完后统一写出
+    void send(Connection *conn, const Reply &reply);
+    void flushDirty();
+    void flush(Connection *conn);
+    void checkBackpressure(Connection *conn);
+    void maybeResumeReading(Connection *conn);
+
+    // 流式回复的分块帧，规则与 ClientHandler 一致
+    std::shared_ptr<ReplyStream> openStream(Connection *conn, const QJsonValue &reqId);
+    void onStreamChunk(Connection *conn, const std::shared_ptr<ReplyStream> &stream, const Reply &frame);
+    void closeStream(Connection *conn, const std::shared_ptr<ReplyStream> &stream);
+    void releaseStalledStreams(Connection *conn);
+
+    void onTimer(quint64 connectionId);
+
+    int m_index;
+    ServerConfig m_config;
+    RequestDispatcher *m_dispatcher;
+    int m_epollFd = -1;
+
+    // 其他线程投递的新连接和异步请求结果；由线程池回调共享持有，反应器释放后仍可安全投递
+    std::shared_ptr<Mailbox> m_mailbox;
+
+    TimerWheel m_timerWheel;
+    // 本线程连接的航班订阅，余票变化通过 eventfd 唤醒后在本轮事件末尾合并推送
+    FlightSubscriptions m_subscriptions;
+    QHash<quint64, Connection *> m_connections;
+    QList<quint64> m_dirty;         // 本轮有回复待写出的连接
+    QList<Connection *> m_closed;   // 本轮已关闭、待释放的连接
+    quint64 m_nextId = 1;
+    QByteArray m_readBuffer;
+    std::atomic<int> m_connectionCount{0};
+    std::atomic<bool> m_stopping{false};
+};
+
+#endif // Q_OS_LINUX
+
+#endif // EPOLLREACTOR_H
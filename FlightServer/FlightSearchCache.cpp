@@ -0,0 +1,69 @@
+#include "FlightSearchCache.h"
+#include "ServerStats.h"
+#include <QMutexLocker>
+#include <QDateTime>
+
+FlightSearchCache::FlightSearchCache(int maxEntries)
+{
+    setMaxEntries(maxEntries);
+}
+
+void FlightSearchCache::setMaxEntries(int maxEntries)
+{
+    QMutexLocker locker(&m_mutex);
+    m_enabled = maxEntries > 0;
+    m_entries.setMaxCost(qMax(0, maxEntries));
+    ServerStats::instance().flightCacheEntries.store(m_entries.size(), std::memory_order_relaxed);
+}
+
+FlightSearchCache::Rows FlightSearchCache::find(const QString &key)
+{
+    ServerStats &stats = ServerStats::instance();
+    Rows rows;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (Rows *cached = m_entries.object(key))
+            rows = *cached;
+    }
+    if (rows)
+        stats.flightCacheHits.fetch_add(1, std::memory_order_relaxed);
+    else
+        stats.flightCacheMisses.fetch_add(1, std::memory_order_relaxed);
+    return rows;
+}
+
+void FlightSearchCache::insert(const QString &key, Rows rows, quint64 generation)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_enabled || generation != m_generation.load(std::memory_order_acquire))
+        return;
+    m_entries.insert(key, new Rows(std::move(rows)));
+    ServerStats::instance().flightCacheEntries.store(m_entries.size(), std::memory_order_relaxed);
+}
+
+bool FlightSearchCache::updateCatalogVersion(const QString &version)
+{
+    ServerStats &stats = ServerStats::instance();
+    stats.flightCacheChecks.fetch_add(1, std::memory_order_relaxed);
+    stats.flightCacheLastCheckMs.store(QDateTime::currentMSecsSinceEpoch(), std::memory_order_relaxed);
+
+    QMutexLocker locker(&m_mutex);
+    const bool changed = !m_catalogVersion.isNull() && version != m_catalogVersion;
+    m_catalogVersion = version;
+    if (!changed)
+        return false;
+
+    locker.unlock();
+    clear();
+    return true;
+}
+
+void FlightSearchCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+    m_entries.clear();
+    ServerStats &stats = ServerStats::instance();
+    stats.flightCacheInvalidations.fetch_add(1, std::memory_order_relaxed);
+    stats.flightCacheEntries.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,46 @@
+#ifndef FLIGHTSEARCHCACHE_H
+#define FLIGHTSEARCHCACHE_H
+
+#include <QString>
+#include <QVector>
+#include <QCache>
+#include <QMutex>
+#include <memory>
+#include <atomic>
+#include "CommonDef.h"
+
+// 航班查询结果缓存，按（出发地, 目的地, 日期）缓存 flightdata 中与用户无关的行。
+// 余票与是否已预订不进缓存，回复时再从内存余票表和用户订单合并，所以订退票不用失效缓存；
+// 只有航班目录本身被外部改动（定期校验发现）时才整体清空
+class FlightSearchCache
+{
+public:
+    // 按航班 id 升序；remaining 为载入时数据库中的余票，航班不在内存余票表中时使用，is_booked 恒为 false
+    using Rows = std::shared_ptr<const QVector<FlightData>>;
+
+    explicit FlightSearchCache(int maxEntries = 1024);
+
+    // 0 表示关闭缓存
+    void setMaxEntries(int maxEntries);
+    bool isEnabled() const { return m_enabled; }
+
+    // 线程安全；未命中返回空指针
+    Rows find(const QString &key);
+
+    // 查询数据库前取一次代数，插入时代数已变（期间缓存被清空）则丢弃这份结果
+    quint64 generation() const { return m_generation.load(std::memory_order_acquire); }
+    void insert(const QString &key, Rows rows, quint64 generation);
+
+    // 比较航班目录的校验值，与上次不同时清空缓存并返回 true；第一次调用只记录
+    bool updateCatalogVersion(const QString &version);
+    void clear();
+
+private:
+    QMutex m_mutex;
+    QCache<QString, Rows> m_entries;
+    QString m_catalogVersion;
+    std::atomic<quint64> m_generation{0};
+    bool m_enabled = true;
+};
+
+#endif // FLIGHTSEARCHCACHE_H
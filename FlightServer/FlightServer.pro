@@ -1,4 +1,4 @@
-QT += core network sql
+QT += core network sql concurrent
 QT -= gui
 
 CONFIG += c++17 cmdline
@@ -8,9 +8,34 @@ CONFIG += c++17 cmdline
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        Acceptor.cpp \
+        BookedFlightIndex.cpp \
         ClientHandler.cpp \
+        ConnectionBench.cpp \
+        ConnectionTimeouts.cpp \
+        DbConnectionPool.cpp \
         DbHandler.cpp \
+        EncoderBench.cpp \
+        EpollReactor.cpp \
+        FlightSearchCache.cpp \
+        FrameDecoder.cpp \
+        IoWorker.cpp \
+        LoadBench.cpp \
+        LogCategories.cpp \
+        Reply.cpp \
+        ReplyStream.cpp \
+        ReplyWriter.cpp \
+        RequestDispatcher.cpp \
+        SchemaMigrator.cpp \
+        SeatInventory.cpp \
+        SeatMap.cpp \
+        ServerStats.cpp \
+        SqlStatements.cpp \
+        SubscriptionHub.cpp \
         TcpServer.cpp \
+        TimerWheel.cpp \
+        WireEncoder.cpp \
+        WorkerPool.cpp \
         main.cpp
 
 # Default rules for deployment.
@@ -19,8 +44,34 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    Acceptor.h \
+    BookedFlightIndex.h \
     ClientHandler.h \
     CommonDef.h \
+    ConnectionBench.h \
+    ConnectionTimeouts.h \
+    DbConnectionPool.h \
     DbHandler.h \
+    EncoderBench.h \
+    EpollReactor.h \
+    FlightSearchCache.h \
+    FrameDecoder.h \
+    IoWorker.h \
+    LoadBench.h \
+    LogCategories.h \
     NetworkUtils.h \
-    TcpServer.h
+    Reply.h \
+    ReplyStream.h \
+    ReplyWriter.h \
+    RequestDispatcher.h \
+    SchemaMigrator.h \
+    SeatInventory.h \
+    SeatMap.h \
+    ServerConfig.h \
+    ServerStats.h \
+    SqlStatements.h \
+    SubscriptionHub.h \
+    TcpServer.h \
+    TimerWheel.h \
+    WireEncoder.h \
+    WorkerPool.h
@@ -0,0 +1,95 @@
+#include "FrameDecoder.h"
+#include <QtEndian>
+
+static constexpr qsizetype kLengthSize = sizeof(quint32);
+
+FrameDecoder::FrameDecoder(quint32 maxFrameSize) : m_maxFrameSize(maxFrameSize) {}
+
+void FrameDecoder::append(const QByteArray &data)
+{
+    // 超长帧的剩余部分到达时直接丢弃，缓冲区不会因恶意长度而膨胀
+    if (m_skipRemaining > 0 && m_readPos >= m_buffer.size()) {
+        if (data.size() <= m_skipRemaining) {
+            m_skipRemaining -= data.size();
+            return;
+        }
+        m_buffer.append(QByteArrayView(data).sliced(m_skipRemaining));
+        m_skipRemaining = 0;
+        return;
+    }
+    m_buffer.append(data);
+}
+
+FrameDecoder::Status FrameDecoder::next(QByteArray &payload)
+{
+    if (m_skipRemaining > 0) {
+        discardSkipped();
+        if (m_skipRemaining > 0) {
+            compact();
+            return NeedMore;
+        }
+    }
+
+    const qsizetype available = m_buffer.size() - m_readPos;
+    if (available < kLengthSize) {
+        compact();
+        return NeedMore;
+    }
+
+    const uchar *head = reinterpret_cast<const uchar *>(m_buffer.constData() + m_readPos);
+    const quint32 frameSize = qFromBigEndian<quint32>(head);
+    if (frameSize > m_maxFrameSize) {
+        m_readPos += kLengthSize;
+        m_skipRemaining = frameSize;
+        discardSkipped();
+        return FrameTooLarge;
+    }
+
+    if (available - kLengthSize < qsizetype(frameSize)) {
+        compact();
+        return NeedMore;
+    }
+
+    // 外层帧已完整，无论内层是否合法都整体消费掉，保证后续帧对齐
+    const qsizetype frameStart = m_readPos + kLengthSize;
+    m_readPos = frameStart + frameSize;
+
+    // 内层是 QDataStream 写出的 QByteArray：[quint32 长度][内容]，0xFFFFFFFF 表示空
+    if (frameSize < kLengthSize)
+        return Malformed;
+    quint32 innerSize = qFromBigEndian<quint32>(head + kLengthSize);
+    if (innerSize == 0xFFFFFFFF)
+        innerSize = 0;
+    if (innerSize > frameSize - kLengthSize)
+        return Malformed;
+
+    payload = m_buffer.mid(frameStart + kLengthSize, innerSize);
+    return FrameReady;
+}
+
+void FrameDecoder::reset()
+{
+    m_buffer.clear();
+    m_readPos = 0;
+    m_skipRemaining = 0;
+}
+
+void FrameDecoder::discardSkipped()
+{
+    const qint64 available = m_buffer.size() - m_readPos;
+    const qint64 n = qMin(available, m_skipRemaining);
+    m_readPos += n;
+    m_skipRemaining -= n;
+}
+
+void FrameDecoder::compact()
+{
+    // 一次 readyRead 只在取完所有完整帧后搬移一次剩余数据
+    if (m_readPos == 0)
+        return;
+    if (m_readPos >= m_buffer.size())
+        m_buffer.clear();
+    else
+        m_buffer.remove(0, m_readPos);
+    m_readPos = 0;
+}
@@ -0,0 +1,40 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QByteArray>
+
+// 每个连接独立的分帧解码器
+// 帧格式与 NetworkUtils::sendJson 一致：[quint32 帧长][QDataStream 序列化的 QByteArray]
+class FrameDecoder
+{
+public:
+    enum Status {
+        NeedMore,       // 缓冲区中没有完整帧
+        FrameReady,     // 取出了一帧
+        FrameTooLarge,  // 帧长超过上限，该帧内容将被跳过而不缓存
+        Malformed       // 帧内结构错误，该帧已被丢弃
+    };
+
+    explicit FrameDecoder(quint32 maxFrameSize);
+
+    void append(const QByteArray &data);
+
+    // 取出下一帧的载荷，调用方应循环调用直到返回 NeedMore
+    Status next(QByteArray &payload);
+
+    qsizetype bufferedBytes() const { return m_buffer.size() - m_readPos; }
+    bool isSkipping() const { return m_skipRemaining > 0; }
+    quint32 maxFrameSize() const { return m_maxFrameSize; }
+    void reset();
+
+private:
+    void compact();
+    void discardSkipped();
+
+    QByteArray m_buffer;
+    qsizetype m_readPos = 0;
+    qint64 m_skipRemaining = 0;     // 超长帧尚未到达、需直接丢弃的字节数
+    quint32 m_maxFrameSize;
+};
+
+#endif // FRAMEDECODER_H
@@ -0,0 +1,55 @@
+#include "IoWorker.h"
+#include "ClientHandler.h"
+#include "ServerStats.h"
+#include <QDebug>
+
+IoWorker::IoWorker(int index, const ServerConfig &config, RequestDispatcher *dispatcher, QObject *parent)
+    : QObject(parent), m_index(index), m_config(config), m_dispatcher(dispatcher),
+      m_timerWheel(config.timerTickMs),
+      m_subscriptions([this]() {
+          QMetaObject::invokeMethod(this, [this]() { m_subscriptions.drain(); }, Qt::QueuedConnection);
+      })
+{
+    // 子对象随 moveToThread 一起迁移到工作线程
+    m_wheelTimer = new QTimer(this);
+    m_wheelTimer->setInterval(m_timerWheel.tickMs());
+    connect(m_wheelTimer, &QTimer::timeout, this, [this]() {
+        m_timerWheel.advance(m_timerWheel.now());
+    });
+}
+
+IoWorker::~IoWorker()
+{
+    // 连接会在析构时取消自己的定时器，必须先于时间轮释放
+    qDeleteAll(findChildren<ClientHandler *>(QString(), Qt::FindDirectChildrenOnly));
+}
+
+void IoWorker::addConnection(qintptr socketDescriptor)
+{
+    if (!m_wheelTimer->isActive())
+        m_wheelTimer->start();
+
+    // 活动连接数已在接受时由 TcpServer 计入
+    ClientHandler *handler = new ClientHandler(socketDescriptor, m_config, m_dispatcher, &m_timerWheel,
+                                               &m_subscriptions, this);
+    if (!handler->start()) {
+        delete handler;
+        ServerStats::instance().connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    m_connectionCount.fetch_add(1, std::memory_order_relaxed);
+    connect(handler, &QObject::destroyed, this, [this]() {
+        m_connectionCount.fetch_sub(1, std::memory_order_relaxed);
+        ServerStats::instance().connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+    });
+
+    qDebug() << "工作线程" << m_index << "接管连接：" << socketDescriptor
+             << "当前连接数：" << connectionCount();
+}
+
+void IoWorker::shutdown()
+{
+    m_wheelTimer->stop();
+    qDeleteAll(findChildren<ClientHandler *>(QString(), Qt::FindDirectChildrenOnly));
+}
@@ -0,0 +1,44 @@
+#ifndef IOWORKER_H
+#define IOWORKER_H
+
+#include <QObject>
+#include <QTimer>
+#include <atomic>
+#include "RequestDispatcher.h"
+#include "ServerConfig.h"
+#include "TimerWheel.h"
+#include "SubscriptionHub.h"
+
+// 一个 I/O 工作线程上的连接宿主：在本线程事件循环中创建并驱动多个 ClientHandler
+class IoWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IoWorker(int index, const ServerConfig &config, RequestDispatcher *dispatcher, QObject *parent = nullptr);
+    ~IoWorker();
+
+    int index() const { return m_index; }
+    int connectionCount() const { return m_connectionCount.load(std::memory_order_relaxed); }
+
+public slots:
+    // 在工作线程中接管已接受的套接字
+    void addConnection(qintptr socketDescriptor);
+
+    // 在工作线程中关闭所有连接并停止定时器，线程退出前调用
+    void shutdown();
+
+private:
+    int m_index;
+    ServerConfig m_config;
+    RequestDispatcher *m_dispatcher;
+    std::atomic<int> m_connectionCount{0};
+
+    // 本线程所有连接共用的时间轮，由一个 QTimer 推进
+    TimerWheel m_timerWheel;
+    QTimer *m_wheelTimer;
+
+    // 本线程连接的航班订阅，余票变化在下一轮事件循环中合并推送
+    FlightSubscriptions m_subscriptions;
+};
+
+#endif // IOWORKER_H
@@ -0,0 +1,343 @@
+#include "LoadBench.h"
+#include "ConnectionBench.h"
+#include "FrameDecoder.h"
+#include "NetworkUtils.h"
+#include <QThread>
+#include <QList>
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+// 回复帧上限，只需容下压测请求的回复
+constexpr quint32 kMaxReplySize = 16 * 1024 * 1024;
+constexpr int kMaxEvents = 256;
+constexpr int kWaitMs = 50;
+constexpr qint64 kNsPerSec = 1000 * 1000 * 1000;
+
+// 各客户端线程共用的参数与开始、结束时间
+struct Shared {
+    sockaddr_storage addr;
+    socklen_t addrLen = 0;
+    QByteArray frame;                       // 每次发送的请求帧
+    QElapsedTimer clock;
+    std::atomic<qint64> measureFromNs{0};   // 此后完成的请求才计入结果
+    std::atomic<qint64> stopAtNs{0};
+    QSemaphore connected;                   // 各线程建立完连接后释放
+    QSemaphore go;                          // 主线程定好时间后释放
+};
+
+struct ThreadResult {
+    int connected = 0;
+    int failed = 0;                         // 建立失败的连接
+    int dropped = 0;                        // 压测中被关闭的连接
+    qint64 busy = 0;                        // 收到 server_busy 的次数
+    std::vector<quint32> latenciesUs;
+};
+
+struct Client {
+    int fd = -1;
+    FrameDecoder decoder{kMaxReplySize};
+    qsizetype written = 0;                  // 当前请求帧已写出的字节数
+    qint64 sentAtNs = 0;                    // 当前请求的发出时间，0 表示没有在途请求
+    bool wantWrite = false;
+};
+
+class ClientThread
+{
+public:
+    ClientThread(Shared &shared, ThreadResult &result, int epfd)
+        : m_shared(shared), m_result(result), m_epfd(epfd) {}
+
+    void run(int count);
+
+private:
+    bool open(Client &client);
+    bool send(Client &client);
+    bool flush(Client &client);
+    bool readReplies(Client &client);
+    void setWantWrite(Client &client, bool want);
+
+    Shared &m_shared;
+    ThreadResult &m_result;
+    int m_epfd;
+};
+
+void ClientThread::run(int count)
+{
+    std::vector<Client> clients(count);
+    for (Client &client : clients) {
+        if (open(client))
+            ++m_result.connected;
+        else
+            ++m_result.failed;
+    }
+    m_shared.connected.release();
+    m_shared.go.acquire();
+
+    for (Client &client : clients) {
+        if (client.fd >= 0 && !send(client)) {
+            ::close(client.fd);
+            client.fd = -1;
+            ++m_result.dropped;
+        }
+    }
+
+    epoll_event events[kMaxEvents];
+    while (m_shared.clock.nsecsElapsed() < m_shared.stopAtNs.load(std::memory_order_relaxed)) {
+        const int n = ::epoll_wait(m_epfd, events, kMaxEvents, kWaitMs);
+        for (int i = 0; i < n; ++i) {
+            Client &client = *static_cast<Client *>(events[i].data.ptr);
+            if (client.fd < 0)
+                continue;
+            bool ok = true;
+            if (events[i].events & EPOLLOUT)
+                ok = flush(client);
+            if (ok && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                ok = readReplies(client);
+            if (!ok) {
+                ::close(client.fd);
+                client.fd = -1;
+                ++m_result.dropped;
+            }
+        }
+    }
+
+    for (Client &client : clients) {
+        if (client.fd >= 0)
+            ::close(client.fd);
+    }
+}
+
+bool ClientThread::open(Client &client)
+{
+    // 建立连接阶段不计时，直接阻塞 connect，之后再切换为非阻塞
+    const int fd = ::socket(m_shared.addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&m_shared.addr), m_shared.addrLen) != 0) {
+        ::close(fd);
+        return false;
+    }
+    const int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = &client;
+    if (::epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        ::close(fd);
+        return false;
+    }
+    client.fd = fd;
+    return true;
+}
+
+bool ClientThread::send(Client &client)
+{
+    client.written = 0;
+    client.sentAtNs = m_shared.clock.nsecsElapsed();
+    return flush(client);
+}
+
+bool ClientThread::flush(Client &client)
+{
+    const QByteArray &frame = m_shared.frame;
+    while (client.written < frame.size()) {
+        const ssize_t n = ::send(client.fd, frame.constData() + client.written,
+                                 size_t(frame.size() - client.written), MSG_NOSIGNAL);
+        if (n > 0) {
+            client.written += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            setWantWrite(client, true);
+            return true;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    setWantWrite(client, false);
+    return true;
+}
+
+void ClientThread::setWantWrite(Client &client, bool want)
+{
+    if (client.wantWrite == want)
+        return;
+    client.wantWrite = want;
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = want ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.ptr = &client;
+    ::epoll_ctl(m_epfd, EPOLL_CTL_MOD, client.fd, &event);
+}
+
+bool ClientThread::readReplies(Client &client)
+{
+    char buffer[64 * 1024];
+    for (;;) {
+        const ssize_t n = ::recv(client.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            client.decoder.append(QByteArray::fromRawData(buffer, n));
+            if (size_t(n) < sizeof(buffer))
+                break;
+        } else if (n == 0) {
+            return false;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    QByteArray payload;
+    for (;;) {
+        const FrameDecoder::Status status = client.decoder.next(payload);
+        if (status == FrameDecoder::NeedMore)
+            return true;
+        if (status != FrameDecoder::FrameReady)
+            return false;
+        // 心跳、订阅推送等不是对当前请求的回复
+        if (client.sentAtNs == 0)
+            continue;
+
+        const qint64 now = m_shared.clock.nsecsElapsed();
+        if (now >= m_shared.measureFromNs.load(std::memory_order_relaxed)
+            && now < m_shared.stopAtNs.load(std::memory_order_relaxed)) {
+            m_result.latenciesUs.push_back(quint32(qMin<qint64>((now - client.sentAtNs) / 1000, 0xFFFFFFFF)));
+            // 压测请求用 JSON 编码，按字节查找即可，不必解析整条回复
+            if (payload.contains("\"server_busy\""))
+                ++m_result.busy;
+        }
+        client.sentAtNs = 0;
+        if (now < m_shared.stopAtNs.load(std::memory_order_relaxed) && !send(client))
+            return false;
+    }
+}
+
+bool resolve(const QString &host, quint16 port, Shared &shared)
+{
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *found = nullptr;
+    const int rc = ::getaddrinfo(host.toUtf8().constData(), QByteArray::number(port).constData(), &hints, &found);
+    if (rc != 0 || !found) {
+        qCritical() << "解析服务端地址失败：" << host << gai_strerror(rc);
+        return false;
+    }
+    std::memcpy(&shared.addr, found->ai_addr, found->ai_addrlen);
+    shared.addrLen = found->ai_addrlen;
+    ::freeaddrinfo(found);
+    return true;
+}
+}
+#endif
+
+int LoadBench::run(const Options &options)
+{
+#ifdef Q_OS_LINUX
+    const int connections = qMax(1, options.connections);
+    const int threads = qBound(1, options.threads > 0 ? options.threads : QThread::idealThreadCount(), connections);
+    const int warmupSec = qMax(0, options.warmupSec);
+    const int durationSec = qMax(1, options.durationSec);
+    const QJsonObject request = options.request.isEmpty() ? QJsonObject{{"type", "get_server_stats"}}
+                                                          : options.request;
+
+    if (!ConnectionBench::raiseOpenFileLimit(connections + 64)) {
+        qCritical() << "打开文件数上限不足以建立" << connections << "个连接，请先调高 ulimit -n";
+        return 1;
+    }
+
+    Shared shared;
+    if (!resolve(options.host, options.port, shared))
+        return 1;
+    NetworkUtils::appendFrame(shared.frame, request, NetworkUtils::Json);
+    shared.clock.start();
+
+    qInfo().noquote() << QString("压测：%1:%2，%3 个连接，%4 个线程，预热 %5 s，测量 %6 s，请求类型 %7")
+                             .arg(options.host).arg(options.port).arg(connections).arg(threads)
+                             .arg(warmupSec).arg(durationSec).arg(request["type"].toString());
+
+    std::vector<ThreadResult> results(threads);
+    QList<QThread *> workers;
+    for (int t = 0; t < threads; ++t) {
+        const int count = connections / threads + (t < connections % threads ? 1 : 0);
+        QThread *thread = QThread::create([&shared, &results, t, count]() {
+            const int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+            ClientThread(shared, results[t], epfd).run(count);
+            ::close(epfd);
+        });
+        thread->setObjectName(QString("load_%1").arg(t));
+        thread->start();
+        workers.append(thread);
+    }
+
+    shared.connected.acquire(threads);
+    int connected = 0;
+    int failed = 0;
+    for (const ThreadResult &result : results) {
+        connected += result.connected;
+        failed += result.failed;
+    }
+    qInfo().noquote() << QString("  已建立 %1 个连接，失败 %2 个").arg(connected).arg(failed);
+
+    const qint64 start = shared.clock.nsecsElapsed();
+    shared.measureFromNs.store(start + warmupSec * kNsPerSec);
+    shared.stopAtNs.store(connected > 0 ? start + (warmupSec + durationSec) * kNsPerSec : start);
+    shared.go.release(threads);
+    for (QThread *thread : std::as_const(workers)) {
+        thread->wait();
+        delete thread;
+    }
+    if (connected == 0)
+        return 1;
+
+    std::vector<quint32> latencies;
+    qint64 busy = 0;
+    int dropped = 0;
+    for (ThreadResult &result : results) {
+        latencies.insert(latencies.end(), result.latenciesUs.begin(), result.latenciesUs.end());
+        busy += result.busy;
+        dropped += result.dropped;
+    }
+    if (latencies.empty()) {
+        qWarning() << "  测量期间没有完成任何请求";
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double q) { return latencies[size_t(q * double(latencies.size() - 1))]; };
+    qInfo().noquote() << QString("  %1 请求/秒（共 %2 个）")
+                             .arg(double(latencies.size()) / durationSec, 0, 'f', 0)
+                             .arg(latencies.size());
+    qInfo().noquote() << QString("  延迟 p50 %1 us，p99 %2 us，p999 %3 us，最大 %4 us")
+                             .arg(percentile(0.50)).arg(percentile(0.99)).arg(percentile(0.999))
+                             .arg(latencies.back());
+    if (busy > 0 || dropped > 0)
+        qWarning().noquote() << QString("  server_busy %1 次，压测中断开 %2 个连接").arg(busy).arg(dropped);
+    return 0;
+#else
+    Q_UNUSED(options);
+    qCritical() << "压测客户端仅支持 Linux";
+    return 1;
+#endif
+}
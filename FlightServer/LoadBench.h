@@ -0,0 +1,28 @@
+#ifndef LOADBENCH_H
+#define LOADBENCH_H
+
+#include <QString>
+#include <QJsonObject>
+
+// 压测客户端：向已启动的服务端建立 connections 个连接，每个连接同一时刻只有一个请求在途（闭环），
+// 预热后持续 durationSec 秒，报告请求/秒与 p50/p99/p999 延迟。服务端分别以 --io-backend qt 和 epoll
+// 启动（连接数超过 --max-connections 时需调高），各跑一次即可对比两种后端。
+// 由 --bench-load 启动，客户端自身用 epoll 驱动，仅支持 Linux
+class LoadBench
+{
+public:
+    struct Options {
+        QString host = "127.0.0.1";
+        quint16 port = 0;
+        int connections = 10000;
+        int threads = 0;            // 客户端线程数，0 为 CPU 核数
+        int warmupSec = 2;          // 预热期间的请求不计入结果
+        int durationSec = 30;
+        QJsonObject request;        // 为空时用 get_server_stats：只经过 I/O 与分发，不访问数据库
+    };
+
+    // 返回进程退出码，连接全部失败或没有完成任何请求时返回 1
+    static int run(const Options &options);
+};
+
+#endif // LOADBENCH_H
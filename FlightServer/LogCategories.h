@@ -0,0 +1,10 @@
+#ifndef LOGCATEGORIES_H
+#define LOGCATEGORIES_H
+
+#include <QLoggingCategory>
+
+// 逐帧、逐请求的调试输出，默认关闭，每条请求都打印会拖慢热路径。
+// 排查时用 QT_LOGGING_RULES="flightserver.requests.debug=true" 打开
+Q_DECLARE_LOGGING_CATEGORY(lcRequests)
+
+#endif // LOGCATEGORIES_H
@@ -2,64 +2,185 @@
 #define NETWORKUTILS_H
 
 #include <QTcpSocket>
-#include <QDataStream>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCborStreamWriter>
+#include <QtEndian>
 #include <QDebug>
 
 class NetworkUtils
 {
 public:
-    // 发送带长度前缀的 JSON
-    static void sendJson(QTcpSocket *socket, const QJsonObject &json)
+    // 帧载荷编码，连接建立时为 JSON，客户端可通过 hello 请求切换为 CBOR
+    enum WireFormat {
+        Json,
+        Cbor
+    };
+
+    static QString formatName(WireFormat format)
     {
-        QByteArray jsonBytes = QJsonDocument(json).toJson(QJsonDocument::Compact);
+        return format == Cbor ? QStringLiteral("cbor") : QStringLiteral("json");
+    }
 
-        QByteArray block;
-        QDataStream out(&block, QIODevice::WriteOnly);
-        out.setVersion(QDataStream::Qt_5_14);
+    static bool formatFromName(const QString &name, WireFormat &format)
+    {
+        if (name == "json") {
+            format = Json;
+        } else if (name == "cbor") {
+            format = Cbor;
+        } else {
+            return false;
+        }
+        return true;
+    }
 
-        out << (quint32)0; // 占位长度
-        out << jsonBytes;  // 写JSON数据
+    // 在 out 末尾直接追加一帧：[quint32 帧长][quint32 载荷长][载荷]
+    // 与 QDataStream 写出 QByteArray 的格式一致，但不经过中间缓冲
+    static void appendFrame(QByteArray &out, const QJsonObject &json, WireFormat format)
+    {
+        const qsizetype headerPos = out.size();
+        out.append(2 * sizeof(quint32), '\0');
 
-        out.device()->seek(0);
-        out << (quint32)(block.size() - sizeof(quint32)); // 填入实际长度
+        if (format == Cbor) {
+            QCborStreamWriter writer(&out);
+            writeCbor(writer, json);
+        } else {
+            out.append(QJsonDocument(json).toJson(QJsonDocument::Compact));
+        }
+
+        const quint32 payloadSize = quint32(out.size() - headerPos - 2 * sizeof(quint32));
+        char *header = out.data() + headerPos;
+        qToBigEndian<quint32>(payloadSize + sizeof(quint32), header);
+        qToBigEndian<quint32>(payloadSize, header + sizeof(quint32));
+    }
 
+    // 发送单条带长度前缀的消息，默认 JSON 编码；连接上的常规回复走 ReplyWriter
+    static void sendJson(QTcpSocket *socket, const QJsonObject &json, WireFormat format = Json)
+    {
+        QByteArray block;
+        appendFrame(block, json, format);
         socket->write(block);
-        socket->flush();
     }
 
-    // 接收带长度前缀的 JSON
-    static bool receiveJson(QTcpSocket *socket, QJsonObject &json)
+    // 解析一帧载荷中的 JSON 对象（分帧由每个连接的 FrameDecoder 完成）
+    static bool parseJson(const QByteArray &jsonBytes, QJsonObject &json)
     {
-        static quint32 blockSize = 0;
-        QDataStream in(socket);
-        in.setVersion(QDataStream::Qt_5_14);
-
-        if (blockSize == 0) {
-            if (socket->bytesAvailable() < (int)sizeof(quint32))
-                return false; // 长度不够
-            in >> blockSize;
+        QJsonDocument doc = QJsonDocument::fromJson(jsonBytes);
+        if (!doc.isObject()) {
+            qWarning() << "收到的不是有效 JSON";
+            return false;
         }
+        json = doc.object();
+        return true;
+    }
 
-        if (socket->bytesAvailable() < blockSize)
-            return false; // 数据不够
+    // 按连接当前编码解析帧载荷
+    static bool decodePayload(const QByteArray &bytes, WireFormat format, QJsonObject &json)
+    {
+        if (format == Json)
+            return parseJson(bytes, json);
 
-        QByteArray jsonBytes;
-        in >> jsonBytes;
+        QCborParserError error;
+        QCborValue value = QCborValue::fromCbor(bytes, &error);
+        if (error.error != QCborError::NoError || !value.isMap()) {
+            qWarning() << "收到的不是有效 CBOR：" << error.errorString();
+            return false;
+        }
+        json = value.toMap().toJsonObject();
+        return true;
+    }
 
-        QJsonDocument doc = QJsonDocument::fromJson(jsonBytes);
-        if (doc.isObject()) {
-            json = doc.object();
-        } else {
-            qWarning() << "收到的不是有效 JSON";
-            blockSize = 0; // 重置
+    // 连接级控制消息（hello 编码协商、ping/pong 心跳），两种 I/O 后端共用
+    // 返回 false 表示不是控制消息；reply 为空时无需回复，否则按 format 的旧值发送后再切换为 nextFormat
+    static bool handleControlMessage(const QJsonObject &request, WireFormat format,
+                                     QJsonObject &reply, WireFormat &nextFormat)
+    {
+        const QString type = request["type"].toString();
+        nextFormat = format;
+        reply = QJsonObject();
+
+        if (type == "pong")
+            return true;    // 收到数据时已刷新活动时间
+        if (type == "ping") {
+            reply["type"] = "pong";
+            if (request.contains("req_id"))
+                reply["req_id"] = request["req_id"];
+            return true;
+        }
+        if (type != "hello")
             return false;
+
+        QJsonObject data = request["data"].isObject() ? request["data"].toObject() : request;
+        QString encoding = data["encoding"].toString(formatName(format));
+
+        reply["type"] = "hello_reply";
+        if (request.contains("req_id"))
+            reply["req_id"] = request["req_id"];
+
+        WireFormat requested;
+        if (!formatFromName(encoding, requested)) {
+            reply["success"] = false;
+            reply["message"] = "不支持的编码：" + encoding;
+            return true;
         }
 
-        blockSize = 0; // 重置，准备接收下一个包
+        reply["success"] = true;
+        reply["data"] = QJsonObject{
+            {"encoding", formatName(requested)},
+            {"encodings", QJsonArray{"json", "cbor"}}
+        };
+        nextFormat = requested;
         return true;
     }
+
+    // 将 JSON 值逐个写入 CBOR 流，不构造中间的 QCborValue 树；WireEncoder 写信封字段时也用它
+    static void writeCbor(QCborStreamWriter &writer, const QJsonValue &value)
+    {
+        switch (value.type()) {
+        case QJsonValue::Null:
+            writer.append(nullptr);
+            break;
+        case QJsonValue::Bool:
+            writer.append(value.toBool());
+            break;
+        case QJsonValue::Double: {
+            const double d = value.toDouble();
+            const qint64 i = value.toInteger();
+            if (double(i) == d)
+                writer.append(i);
+            else
+                writer.append(d);
+            break;
+        }
+        case QJsonValue::String:
+            writer.append(value.toString());
+            break;
+        case QJsonValue::Array: {
+            const QJsonArray array = value.toArray();
+            writer.startArray(quint64(array.size()));
+            for (const QJsonValue &item : array)
+                writeCbor(writer, item);
+            writer.endArray();
+            break;
+        }
+        case QJsonValue::Object: {
+            const QJsonObject object = value.toObject();
+            writer.startMap(quint64(object.size()));
+            for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+                writer.append(it.key());
+                writeCbor(writer, it.value());
+            }
+            writer.endMap();
+            break;
+        }
+        case QJsonValue::Undefined:
+            writer.appendUndefined();
+            break;
+        }
+    }
 };
 
 #endif // NETWORKUTILS_H
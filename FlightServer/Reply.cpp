@@ -0,0 +1,81 @@
+#include "Reply.h"
+#include <QJsonDocument>
+
+void writeRow(WireEncoder &encoder, const FlightData &flight)
+{
+    encoder.beginMap(13);
+    encoder.field(QLatin1String("flight_number"), flight.flight_num);
+    encoder.field(QLatin1String("airline"), flight.airline);
+    encoder.field(QLatin1String("startCity"), flight.from_city);
+    encoder.field(QLatin1String("endCity"), flight.to_city);
+    encoder.field(QLatin1String("startAirport"), flight.from_airport);
+    encoder.field(QLatin1String("endAirport"), flight.to_airport);
+    encoder.field(QLatin1String("startDate"), flight.date);
+    encoder.field(QLatin1String("endDate"), flight.date);
+    encoder.field(QLatin1String("startTime"), flight.depart_time);
+    encoder.field(QLatin1String("endTime"), flight.arrive_time);
+    encoder.field(QLatin1String("price"), flight.price);
+    encoder.field(QLatin1String("status"), flight.remaining > 0 ? QStringLiteral("有票") : QStringLiteral("售罄"));
+    encoder.field(QLatin1String("isBooked"), flight.is_booked);
+    encoder.endMap();
+}
+
+void writeRow(WireEncoder &encoder, const OrderData &order)
+{
+    encoder.beginMap(12);
+    encoder.field(QLatin1String("order_num"), order.order_num);
+    encoder.field(QLatin1String("flight_num"), order.flight_num);
+    encoder.field(QLatin1String("from_city"), order.from_city);
+    encoder.field(QLatin1String("from_airport"), order.from_airport);
+    encoder.field(QLatin1String("to_city"), order.to_city);
+    encoder.field(QLatin1String("to_airport"), order.to_airport);
+    encoder.field(QLatin1String("date"), order.date);
+    encoder.field(QLatin1String("depart_time"), order.depart_time);
+    encoder.field(QLatin1String("arrive_time"), order.arrive_time);
+    encoder.field(QLatin1String("status"), order.status);
+    encoder.field(QLatin1String("price"), order.price);
+    encoder.field(QLatin1String("create_time"), order.create_time);
+    encoder.endMap();
+}
+
+QJsonArray RowSet::toJsonArray() const
+{
+    QByteArray frame;
+    {
+        WireEncoder encoder(frame, NetworkUtils::Json);
+        encode(encoder);
+    }
+    // 跳过帧头
+    return QJsonDocument::fromJson(frame.mid(2 * sizeof(quint32))).array();
+}
+
+QJsonObject Reply::toJson() const
+{
+    if (!rows)
+        return json;
+    QJsonObject merged = json;
+    merged["data"] = rows->toJsonArray();
+    return merged;
+}
+
+void Reply::appendFrame(QByteArray &out, NetworkUtils::WireFormat format) const
+{
+    if (!rows) {
+        NetworkUtils::appendFrame(out, json, format);
+        return;
+    }
+
+    const bool hasData = json.contains("data");
+    WireEncoder encoder(out, format);
+    encoder.beginMap(json.size() + (hasData ? 0 : 1));
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it) {
+        if (it.key() == QLatin1String("data"))
+            continue;
+        encoder.key(it.key());
+        encoder.value(QJsonValue(it.value()));
+    }
+    encoder.key(QLatin1String("data"));
+    rows->encode(encoder);
+    encoder.endMap();
+    encoder.finish();
+}
@@ -0,0 +1,73 @@
+#ifndef REPLY_H
+#define REPLY_H
+
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVector>
+#include <memory>
+#include "CommonDef.h"
+#include "NetworkUtils.h"
+#include "WireEncoder.h"
+
+// 行的线上格式，逐个字段直接写入编码器
+void writeRow(WireEncoder &encoder, const FlightData &flight);
+void writeRow(WireEncoder &encoder, const OrderData &order);
+
+// 不进 JSON 树的行列表：数据访问层返回的记录原样保留，编码帧时逐行写出
+class RowSet
+{
+public:
+    virtual ~RowSet() = default;
+
+    virtual qsizetype size() const = 0;
+    // 写出一个数组
+    virtual void encode(WireEncoder &encoder) const = 0;
+
+    // 需要 JSON 树时（如 batch 的子回复）才转换，编码为 JSON 文本后再解析
+    QJsonArray toJsonArray() const;
+};
+
+template <typename T>
+class TypedRowSet : public RowSet
+{
+public:
+    explicit TypedRowSet(QVector<T> rows) : m_rows(std::move(rows)) {}
+
+    qsizetype size() const override { return m_rows.size(); }
+
+    void encode(WireEncoder &encoder) const override
+    {
+        encoder.beginArray(m_rows.size());
+        for (const T &row : m_rows)
+            writeRow(encoder, row);
+        encoder.endArray();
+    }
+
+private:
+    QVector<T> m_rows;
+};
+
+template <typename T>
+std::shared_ptr<const RowSet> makeRowSet(QVector<T> rows)
+{
+    return std::make_shared<const TypedRowSet<T>>(std::move(rows));
+}
+
+// 一条待发送的回复：信封字段在 json 中，列表回复的行在 rows 中，
+// 由 appendFrame 一次写入输出缓冲区，rows 作为 data 字段跟在信封之后
+struct Reply
+{
+    Reply() = default;
+    Reply(QJsonObject json, std::shared_ptr<const RowSet> rows = nullptr)
+        : json(std::move(json)), rows(std::move(rows)) {}
+
+    // 合并为一个 JSON 对象
+    QJsonObject toJson() const;
+
+    void appendFrame(QByteArray &out, NetworkUtils::WireFormat format) const;
+
+    QJsonObject json;
+    std::shared_ptr<const RowSet> rows;
+};
+
+#endif // REPLY_H
@@ -0,0 +1,59 @@
+#include "ReplyStream.h"
+#include "ServerStats.h"
+#include <QMutexLocker>
+#include <QDeadlineTimer>
+#include <QDebug>
+
+ReplyStream::ReplyStream(const QJsonValue &reqId, Post post, int window, int stallTimeoutMs)
+    : m_reqId(reqId), m_post(std::move(post)), m_window(qMax(1, window)),
+      m_stallTimeoutMs(stallTimeoutMs) {}
+
+bool ReplyStream::push(const QString &type, std::shared_ptr<const RowSet> rows)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QDeadlineTimer deadline(m_stallTimeoutMs);
+    while (!m_cancelled && m_pending >= m_window) {
+        if (!m_credit.wait(&m_mutex, deadline)) {
+            qWarning() << "客户端长时间未读取流式回复，停止推送";
+            m_cancelled = true;
+        }
+    }
+    if (m_cancelled) {
+        ServerStats::instance().streamsAborted.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    QJsonObject frame;
+    frame["type"] = type;
+    frame["seq"] = m_seq++;
+    if (!m_reqId.isUndefined())
+        frame["req_id"] = m_reqId;
+
+    // 持锁投递：cancel 返回后连接可以放心释放，不会再有帧投向它
+    ++m_pending;
+    m_post(shared_from_this(), Reply(frame, std::move(rows)));
+    ServerStats::instance().streamChunks.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ReplyStream::delivered()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pending > 0)
+        --m_pending;
+    m_credit.wakeAll();
+}
+
+void ReplyStream::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cancelled = true;
+    m_credit.wakeAll();
+}
+
+int ReplyStream::chunksPushed() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_seq;
+}
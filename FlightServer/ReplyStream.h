@@ -0,0 +1,48 @@
+#ifndef REPLYSTREAM_H
+#define REPLYSTREAM_H
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+#include "Reply.h"
+
+// 流式回复：处理函数在数据库线程中边读查询结果边把行分块推给连接，每块一帧 <type>_chunk，
+// 结束帧仍是 dispatchAsync 的结果。连接还没接收的块最多 window 个，客户端读得慢时
+// 生产者在 push 中等待，单个请求占用的内存因此以块大小为界，而不是整个结果集
+class ReplyStream : public std::enable_shared_from_this<ReplyStream>
+{
+public:
+    // 在数据库线程调用：把帧交给连接所在线程，写入发送缓冲后由连接调用 stream->delivered()
+    using Post = std::function<void(const std::shared_ptr<ReplyStream> &stream, const Reply &frame)>;
+
+    ReplyStream(const QJsonValue &reqId, Post post, int window = 4, int stallTimeoutMs = 30 * 1000);
+
+    // 数据库线程：推送一块行；连接已关闭或客户端长时间不读时返回 false，生产者应停止查询
+    // 行在连接线程编码帧时才写出，数据库线程不构造 JSON
+    bool push(const QString &type, std::shared_ptr<const RowSet> rows);
+
+    // 连接线程：一块已写入发送缓冲，且待发送数据未超过高水位
+    void delivered();
+
+    // 连接线程：连接关闭，之后不再投递，等待中的生产者立即返回
+    void cancel();
+
+    int chunksPushed() const;
+
+private:
+    QJsonValue m_reqId;
+    Post m_post;
+    int m_window;
+    int m_stallTimeoutMs;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_credit;
+    int m_pending = 0;      // 已投递、连接还没接收的块数
+    int m_seq = 0;
+    bool m_cancelled = false;
+};
+
+#endif // REPLYSTREAM_H
@@ -0,0 +1,28 @@
+#include "ReplyWriter.h"
+
+ReplyWriter::ReplyWriter(QTcpSocket *socket, QObject *parent)
+    : QObject(parent), m_socket(socket) {}
+
+void ReplyWriter::send(const Reply &reply, NetworkUtils::WireFormat format)
+{
+    reply.appendFrame(m_buffer, format);
+
+    // 推迟到本轮事件处理结束后统一写出
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, &ReplyWriter::flush, Qt::QueuedConnection);
+    }
+}
+
+void ReplyWriter::flush()
+{
+    m_flushScheduled = false;
+    if (m_buffer.isEmpty())
+        return;
+
+    if (m_socket->state() == QAbstractSocket::ConnectedState)
+        m_socket->write(m_buffer);
+
+    // 保留容量，下一批回复复用同一块内存
+    m_buffer.resize(0);
+}
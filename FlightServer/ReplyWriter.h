@@ -0,0 +1,32 @@
+#ifndef REPLYWRITER_H
+#define REPLYWRITER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QJsonObject>
+#include "NetworkUtils.h"
+#include "Reply.h"
+
+// 每个连接的回复写出器：回复直接编码进复用的输出缓冲区，
+// 同一轮事件循环内产生的所有回复合并为一次 write
+class ReplyWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReplyWriter(QTcpSocket *socket, QObject *parent = nullptr);
+
+    // 列表回复的行由 Reply 直接编码进缓冲区
+    void send(const Reply &reply, NetworkUtils::WireFormat format);
+
+    // 立即写出缓冲区中的回复
+    void flush();
+
+    qsizetype pendingBytes() const { return m_buffer.size(); }
+
+private:
+    QTcpSocket *m_socket;
+    QByteArray m_buffer;
+    bool m_flushScheduled = false;
+};
+
+#endif // REPLYWRITER_H
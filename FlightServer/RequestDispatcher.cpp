@@ -0,0 +1,528 @@
+#include "RequestDispatcher.h"
+#include "LogCategories.h"
+#include "ServerStats.h"
+#include <QDebug>
+
+RequestDispatcher::RequestDispatcher(DbHandler *dbHandler, const ServerConfig &config)
+    : m_dbHandler(dbHandler), m_maxBatchSize(config.maxBatchSize),
+      m_maxInFlightRequests(config.maxInFlightRequests), m_busyRetryAfterMs(config.busyRetryAfterMs),
+      m_maxPageSize(config.maxPageSize), m_streamChunkRows(qMax(1, config.streamChunkRows))
+{
+    registerHandlers();
+}
+
+RequestDispatcher::~RequestDispatcher()
+{
+    // 等待仍在执行的请求结束，它们引用了本对象
+    m_dbHandler->waitForDone();
+}
+
+// 请求数据可能在 data 字段，也可能直接在根级别；根级别时直接共享原对象，不做拷贝
+static QJsonObject requestData(const QJsonObject &request)
+{
+    const QJsonValue dataValue = request.value("data");
+    return dataValue.isObject() ? dataValue.toObject() : request;
+}
+
+QFuture<Reply> RequestDispatcher::dispatchAsync(const QJsonObject &request,
+                                                std::shared_ptr<ReplyStream> stream)
+{
+    // 整个处理函数（含 batch 的全部子请求）在同一个数据库线程上执行，共用该线程的连接
+    return m_dbHandler->runAsync([this, request, stream]() {
+        Reply resp = dispatchReply(request, stream.get());
+        endRequest();
+        return resp;
+    });
+}
+
+bool RequestDispatcher::wantsStream(const QJsonObject &request) const
+{
+    const HandlerDescriptor *handler = findHandler(request["type"].toString());
+    return handler && handler->streamHandler && requestData(request)["stream"].toBool();
+}
+
+bool RequestDispatcher::runsInline(const QJsonObject &request) const
+{
+    const HandlerDescriptor *handler = findHandler(request["type"].toString());
+    return handler && handler->concurrency == HandlerDescriptor::Concurrency::Light;
+}
+
+bool RequestDispatcher::tryBeginRequest(int slots) const
+{
+    ServerStats &stats = ServerStats::instance();
+    const qint64 inFlight = stats.requestsInFlight.fetch_add(slots, std::memory_order_relaxed) + slots;
+    if (m_maxInFlightRequests > 0 && inFlight > m_maxInFlightRequests) {
+        stats.requestsInFlight.fetch_sub(slots, std::memory_order_relaxed);
+        stats.requestsRejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void RequestDispatcher::endRequest(int slots) const
+{
+    ServerStats::instance().requestsInFlight.fetch_sub(slots, std::memory_order_relaxed);
+}
+
+QJsonObject RequestDispatcher::serverBusyReply(const QString &reason, int retryAfterMs)
+{
+    QJsonObject resp;
+    resp["type"] = "server_busy";
+    resp["success"] = false;
+    resp["message"] = "服务器繁忙，请稍后重试";
+    resp["reason"] = reason;
+    resp["retry_after_ms"] = retryAfterMs;
+    return resp;
+}
+
+void RequestDispatcher::registerHandlers()
+{
+    using C = HandlerDescriptor::Concurrency;
+
+    registerHandler("batch",            {&RequestDispatcher::handleBatch,           {"requests"}, false, C::Composite});
+    registerHandler("get_server_stats", {&RequestDispatcher::handleGetServerStats,  {}, true, C::Light});
+    registerHandler("login",            {&RequestDispatcher::handleLogin,           {"phone", "password"}, true, C::DbRead});
+    registerHandler("register",         {&RequestDispatcher::handleRegister,        {"nickname", "password", "phone"}, false, C::DbWrite});
+    registerHandler("check_phone",      {&RequestDispatcher::handleCheckPhone,      {"phone"}, true, C::DbRead});
+    registerHandler("check_idcard",     {&RequestDispatcher::handleCheckIdCard,     {"idCard"}, true, C::DbRead});
+    registerHandler("get_user_info",    {&RequestDispatcher::handleGetUserInfo,     {"user_id"}, true, C::DbRead});
+    registerHandler("change_password",  {&RequestDispatcher::handleChangePassword,  {"user_id", "old_pwd", "new_pwd"}, false, C::DbWrite});
+    registerHandler("get_flights",      {nullptr,                                   {}, true, C::DbRead,
+                                         &RequestDispatcher::handleGetFlights});
+    registerHandler("book_flight",      {&RequestDispatcher::handleBookFlight,      {"user_id", "flight_number"}, false, C::DbWrite});
+    registerHandler("get_seat_map",     {&RequestDispatcher::handleGetSeatMap,      {"flight_number"}, true, C::DbRead});
+    registerHandler("get_user_orders",  {nullptr,                                   {"user_id"}, true, C::DbRead,
+                                         &RequestDispatcher::handleGetOrders});
+    registerHandler("refund_order",     {&RequestDispatcher::handleRefundOrder,     {"order_id", "user_id"}, false, C::DbWrite});
+    registerHandler("add_passenger",    {&RequestDispatcher::handleAddPassenger,    {"user_id", "real_name", "ID_card_number"}, false, C::DbWrite});
+    registerHandler("get_passengers",   {&RequestDispatcher::handleGetPassengers,   {"user_id"}, true, C::DbRead});
+    registerHandler("update_passenger", {&RequestDispatcher::handleUpdatePassenger, {"id", "user_id"}, false, C::DbWrite});
+    registerHandler("delete_passenger", {&RequestDispatcher::handleDeletePassenger, {"id", "user_id"}, false, C::DbWrite});
+}
+
+void RequestDispatcher::registerHandler(const QString &type, const HandlerDescriptor &descriptor)
+{
+    m_handlers.insert(type, descriptor);
+}
+
+const HandlerDescriptor *RequestDispatcher::findHandler(const QString &type) const
+{
+    auto it = m_handlers.constFind(type);
+    return it == m_handlers.constEnd() ? nullptr : &it.value();
+}
+
+QJsonObject RequestDispatcher::dispatch(const QJsonObject &request) const
+{
+    return dispatchReply(request).toJson();
+}
+
+Reply RequestDispatcher::dispatchReply(const QJsonObject &request, ReplyStream *stream) const
+{
+    const QString type = request["type"].toString();
+
+    // 处理函数只按字段名取值
+    const QJsonObject data = requestData(request);
+
+    qCDebug(lcRequests) << "处理请求类型:" << type;
+
+    const HandlerDescriptor *handler = findHandler(type);
+    if (!handler) {
+        QJsonObject resp;
+        resp["type"] = "error";
+        resp["success"] = false;
+        resp["message"] = "未知请求类型";
+        return resp;
+    }
+
+    for (const QString &field : handler->requiredFields) {
+        if (!data.contains(field)) {
+            QJsonObject resp;
+            resp["type"] = type + "_reply";
+            resp["success"] = false;
+            resp["message"] = "缺少字段：" + field;
+            return resp;
+        }
+    }
+
+    if (handler->streamHandler) {
+        if (stream)
+            ServerStats::instance().streamsStarted.fetch_add(1, std::memory_order_relaxed);
+        return (this->*(handler->streamHandler))(data, stream);
+    }
+    return (this->*(handler->handler))(data);
+}
+
+// ===== 回复格式：数据访问层的记录在这里转换为线上字段，列表行见 Reply.cpp 的 writeRow =====
+static QJsonObject userToJson(const UserData &user, bool withIdCard)
+{
+    QJsonObject json{
+        {"username", user.username},
+        {"realname", user.realname},
+        {"phone", user.phone},
+        {"email", user.email}
+    };
+    if (withIdCard)
+        json["ID_card_number"] = user.id_card_number;
+    return json;
+}
+
+static QJsonObject toJson(const PassengerData &passenger)
+{
+    return QJsonObject{
+        {"id", passenger.id},
+        {"real_name", passenger.real_name},
+        {"ID_card_number", passenger.id_card_number},
+        {"phone_number", passenger.phone_number}
+    };
+}
+
+static QJsonObject toJson(const SeatMapData &map)
+{
+    // 位图按 SeatMap::toBytes 的顺序打包后 base64，整张座位图只有几十个字节
+    return QJsonObject{
+        {"flight_number", map.flight_num},
+        {"rows", SeatMap::kRows},
+        {"columns", "ABCDEF"},
+        {"window", "AF"},
+        {"aisle", "CD"},
+        {"occupied", QString::fromLatin1(map.occupied.toBase64())},
+        {"occupied_count", map.occupied_count},
+        {"remaining", map.remaining}
+    };
+}
+
+template <typename T>
+static QJsonArray toJsonArray(const QVector<T> &rows)
+{
+    QJsonArray array;
+    for (const T &row : rows)
+        array.append(toJson(row));
+    return array;
+}
+
+// 失败时回复 message，成功时由调用方填 data
+static void setStatusReply(QJsonObject &resp, const DbStatus &status)
+{
+    resp["success"] = status.ok();
+    if (!status.ok())
+        resp["message"] = status.msg;
+}
+
+// 列表回复的分页字段；流式回复的行已在分块帧中发出，结束帧只带行数和游标
+template <typename T>
+static void setPageReply(Reply &reply, const Page<T> &page, bool streamed)
+{
+    if (streamed)
+        reply.json["streamed"] = true;
+    else
+        reply.rows = makeRowSet(page.rows);
+    reply.json["count"] = page.count;
+    if (!page.nextCursor.isEmpty())
+        reply.json["next_cursor"] = page.nextCursor;
+}
+
+template <typename T>
+PageRequest<T> RequestDispatcher::pageRequest(const QJsonObject &data, const QString &chunkType,
+                                              ReplyStream *stream) const
+{
+    PageRequest<T> page;
+    page.limit = qMax(0, data["limit"].toInt());
+    if (m_maxPageSize > 0 && page.limit > m_maxPageSize)
+        page.limit = m_maxPageSize;
+    page.cursor = data["cursor"].toString();
+    page.chunkRows = m_streamChunkRows;
+    if (stream) {
+        page.sink = [stream, chunkType](const QVector<T> &rows) {
+            return stream->push(chunkType, makeRowSet(rows));
+        };
+    }
+    return page;
+}
+
+// ===== 业务处理方法 =====
+QJsonObject RequestDispatcher::handleBatch(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "batch_reply";
+
+    QJsonArray requests = data["requests"].toArray();
+    if (requests.isEmpty() || requests.size() > m_maxBatchSize) {
+        resp["success"] = false;
+        resp["message"] = QString("批量请求数量应在 1 到 %1 之间").arg(m_maxBatchSize);
+        return resp;
+    }
+
+    // 有意放弃批内并行：子请求在同一线程内依次执行，外层检出一次连接，子查询嵌套检出时复用它。
+    // 一个批量请求最多占一个数据库线程和一个连接，不会挤占其他客户端，代价是批内延迟为各子请求之和。
+    // 准入按访问数据库的子请求数计：调用方已占了一个名额，这里补上其余的，不能借批量绕过在途上限
+    int dbRequests = 0;
+    for (const QJsonValue &value : std::as_const(requests)) {
+        const QString type = value.toObject()["type"].toString();
+        const HandlerDescriptor *handler = type == "batch" ? nullptr : findHandler(type);
+        if (handler && handler->concurrency != HandlerDescriptor::Concurrency::Light)
+            ++dbRequests;
+    }
+    const int extraSlots = qMax(0, dbRequests - 1);
+    if (extraSlots > 0 && !tryBeginRequest(extraSlots))
+        return serverBusyReply("requests", m_busyRetryAfterMs);
+
+    DbConnectionPool::Lease lease = m_dbHandler->acquireConnection();
+    QJsonArray replies;
+    for (const QJsonValue &value : std::as_const(requests)) {
+        QJsonObject sub = value.toObject();
+        QJsonObject reply;
+        if (sub["type"].toString() == "batch") {
+            reply["type"] = "error";
+            reply["success"] = false;
+            reply["message"] = "不支持嵌套批量请求";
+        } else {
+            reply = dispatch(sub);
+        }
+        if (sub.contains("req_id"))
+            reply["req_id"] = sub["req_id"];
+        replies.append(reply);
+    }
+    lease.release();
+    if (extraSlots > 0)
+        endRequest(extraSlots);
+
+    resp["success"] = true;
+    resp["data"] = replies;
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleGetServerStats(const QJsonObject &data) const
+{
+    Q_UNUSED(data);
+    QJsonObject resp;
+    resp["type"] = "get_server_stats_reply";
+    resp["success"] = true;
+    resp["data"] = ServerStats::instance().toJson();
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleLogin(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "login_reply";
+
+    QString phone = data["phone"].toString();
+    QString password = data["password"].toString();
+
+    const DbResult<UserData> user = m_dbHandler->verifyUser(phone, password);
+    setStatusReply(resp, user.status());
+    if (user) {
+        resp["data"] = userToJson(*user, true);
+        // 添加调试信息
+        qDebug() << "登录成功，返回前端的数据:" << resp["data"].toObject();
+    }
+    return resp;
+}
+
+
+QJsonObject RequestDispatcher::handleRegister(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "register_reply";
+
+    // nickname 对应 username，不需要 realname
+    QString username = data["nickname"].toString();  // nickname 作为 username
+    QString password = data["password"].toString();
+    QString phone = data["phone"].toString();
+    QString idCard = data["id_card"].toString();  // 可选的身份证号
+
+    const DbResult<UserData> user = m_dbHandler->registerUser(username, password, phone, idCard);
+    setStatusReply(resp, user.status());
+    if (user)
+        resp["data"] = QJsonObject{{"username", user->username}, {"phone", user->phone}};
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleCheckPhone(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "check_phone_reply";
+
+    QString phone = data["phone"].toString();
+    const DbResult<bool> exists = m_dbHandler->checkPhoneExists(phone);
+    setStatusReply(resp, exists.status());
+    if (exists)
+        resp["data"] = QJsonObject{{"exists", *exists}};
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleCheckIdCard(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "check_idcard_reply";
+
+    QString idCard = data["idCard"].toString();
+    const DbResult<bool> exists = m_dbHandler->checkIdCardExists(idCard);
+    setStatusReply(resp, exists.status());
+    if (exists)
+        resp["data"] = QJsonObject{{"exists", *exists}};
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleGetUserInfo(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "get_user_info_reply";
+
+    QString username = data["user_id"].toString();
+    const DbResult<UserData> user = m_dbHandler->getUserInfo(username);
+    setStatusReply(resp, user.status());
+    if (user)
+        resp["data"] = userToJson(*user, false);
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleChangePassword(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "change_password_reply";
+
+    QString username = data["user_id"].toString();
+    QString oldPwd = data["old_pwd"].toString();
+    QString newPwd = data["new_pwd"].toString();
+
+    const DbStatus status = m_dbHandler->changePassword(username, oldPwd, newPwd);
+    resp["success"] = status.ok();
+    resp["message"] = status.msg;
+    return resp;
+}
+
+Reply RequestDispatcher::handleGetFlights(const QJsonObject &data, ReplyStream *stream) const
+{
+    Reply resp;
+    resp.json["type"] = "get_flights_reply";
+
+    QString username = data["user_id"].toString();
+    QString from = data["from_city"].toString();
+    QString to = data["to_city"].toString();
+    QString date = data["date"].toString();
+
+    const DbResult<Page<FlightData>> flights = m_dbHandler->getFlightList(
+        username, from, to, date, pageRequest<FlightData>(data, "get_flights_chunk", stream));
+    setStatusReply(resp.json, flights.status());
+    if (flights)
+        setPageReply(resp, *flights, stream != nullptr);
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleBookFlight(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "book_flight_reply";
+
+    QString username = data["user_id"].toString();
+    QString flightNum = data["flight_number"].toString();
+    QString seatPreference = data["seat_preference"].toString();  // 可选：window/aisle/middle
+
+    const DbResult<BookingData> booking = m_dbHandler->bookFlight(username, flightNum, seatPreference);
+    resp["success"] = booking.ok();
+    resp["message"] = booking.msg();
+    if (booking)
+        resp["data"] = QJsonObject{{"order_num", booking->order_num}, {"seat", booking->seat}};
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleGetSeatMap(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "get_seat_map_reply";
+
+    const DbResult<SeatMapData> map = m_dbHandler->getSeatMap(data["flight_number"].toString());
+    setStatusReply(resp, map.status());
+    if (map)
+        resp["data"] = toJson(*map);
+    return resp;
+}
+
+Reply RequestDispatcher::handleGetOrders(const QJsonObject &data, ReplyStream *stream) const
+{
+    Reply resp;
+    resp.json["type"] = "get_user_orders_reply";
+
+    QString username = data["user_id"].toString();
+    const DbResult<Page<OrderData>> orders = m_dbHandler->getOrderListWithFlight(
+        username, pageRequest<OrderData>(data, "get_user_orders_chunk", stream));
+    setStatusReply(resp.json, orders.status());
+    if (orders)
+        setPageReply(resp, *orders, stream != nullptr);
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleRefundOrder(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "refund_order_reply";
+
+    QString orderNum = data["order_id"].toString();
+    QString username = data["user_id"].toString();
+
+    const DbStatus status = m_dbHandler->refundOrder(orderNum, username);
+    resp["success"] = status.ok();
+    resp["message"] = status.msg;
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleAddPassenger(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "add_passenger_reply";
+
+    QString username = data["user_id"].toString();
+    QString realName = data["real_name"].toString();
+    QString idCard = data["ID_card_number"].toString();
+    QString phone = data["phone_number"].toString();
+
+    const DbStatus status = m_dbHandler->addPassenger(username, realName, idCard, phone);
+    resp["success"] = status.ok();
+    resp["message"] = status.msg;
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleGetPassengers(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "get_passengers_reply";
+
+    QString username = data["user_id"].toString();
+    const DbResult<QVector<PassengerData>> passengers = m_dbHandler->getPassengers(username);
+    setStatusReply(resp, passengers.status());
+    if (passengers)
+        resp["data"] = toJsonArray(*passengers);
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleUpdatePassenger(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "update_passenger_reply";
+
+    QString passengerId = data["id"].toString();
+    QString realName = data["real_name"].toString();
+    QString idCard = data["ID_card_number"].toString();
+    QString phone = data["phone_number"].toString();
+    QString username = data["user_id"].toString(); // 用于权限验证
+
+    const DbStatus status = m_dbHandler->updatePassenger(passengerId, username, realName, idCard, phone);
+    resp["success"] = status.ok();
+    resp["message"] = status.msg;
+    return resp;
+}
+
+QJsonObject RequestDispatcher::handleDeletePassenger(const QJsonObject &data) const
+{
+    QJsonObject resp;
+    resp["type"] = "delete_passenger_reply";
+
+    QString passengerId = data["id"].toString();
+    QString username = data["user_id"].toString(); // 用于权限验证
+
+    const DbStatus status = m_dbHandler->deletePassenger(passengerId, username);
+    resp["success"] = status.ok();
+    resp["message"] = status.msg;
+    return resp;
+}
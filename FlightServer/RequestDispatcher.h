@@ -0,0 +1,110 @@
+#ifndef REQUESTDISPATCHER_H
+#define REQUESTDISPATCHER_H
+
+#include <QJsonObject>
+#include <QHash>
+#include <QStringList>
+#include <QFuture>
+#include <memory>
+#include "DbHandler.h"
+#include "ServerConfig.h"
+#include "ReplyStream.h"
+#include "Reply.h"
+
+class RequestDispatcher;
+
+// 请求类型对应的处理描述，由分发器注册表按类型 O(1) 查找
+struct HandlerDescriptor
+{
+    // 并发类别，供调度与统计使用
+    enum class Concurrency {
+        Light,      // 不访问数据库
+        DbRead,     // 只读查询，可任意并发
+        DbWrite,    // 修改数据
+        Composite   // 由多个子请求组成
+    };
+
+    using Handler = QJsonObject (RequestDispatcher::*)(const QJsonObject &data) const;
+    // 列表处理函数：行放在 Reply::rows 中不进 JSON 树；可流式回复，stream 为空时按普通回复处理
+    using StreamHandler = Reply (RequestDispatcher::*)(const QJsonObject &data, ReplyStream *stream) const;
+
+    Handler handler = nullptr;
+    QStringList requiredFields;   // 缺少任一字段时直接返回错误
+    bool readOnly = true;
+    Concurrency concurrency = Concurrency::DbRead;
+    StreamHandler streamHandler = nullptr;  // 设置后取代 handler
+};
+
+// 请求分发与业务处理，不依赖具体连接，可在任意线程执行
+class RequestDispatcher
+{
+public:
+    RequestDispatcher(DbHandler *dbHandler, const ServerConfig &config);
+    ~RequestDispatcher();
+
+    // 在调用线程同步处理，返回回复；stream 不为空且类型支持时，结果行分块推给 stream。
+    // 列表回复的行留在 Reply::rows 中，由连接编码帧时直接写出
+    Reply dispatchReply(const QJsonObject &request, ReplyStream *stream = nullptr) const;
+
+    // 同 dispatchReply，但合并为一个 JSON 对象
+    QJsonObject dispatch(const QJsonObject &request) const;
+
+    // 在数据库线程池中处理，I/O 线程不会阻塞在数据库上；
+    // 调用前须已通过 tryBeginRequest 占用在途名额，任务结束时自动归还
+    QFuture<Reply> dispatchAsync(const QJsonObject &request,
+                                 std::shared_ptr<ReplyStream> stream = nullptr);
+
+    // 请求带 stream: true 且类型支持流式回复时，连接应为它建立 ReplyStream
+    bool wantsStream(const QJsonObject &request) const;
+
+    // 不访问数据库的请求（Light）直接在 I/O 线程处理，不必进线程池
+    bool runsInline(const QJsonObject &request) const;
+
+    // 在途请求准入：一次占 slots 个名额，超过上限时返回 false，调用方应回复 serverBusyReply
+    bool tryBeginRequest(int slots = 1) const;
+    void endRequest(int slots = 1) const;
+
+    static QJsonObject serverBusyReply(const QString &reason, int retryAfterMs);
+    int busyRetryAfterMs() const { return m_busyRetryAfterMs; }
+
+    // 未注册的类型返回 nullptr
+    const HandlerDescriptor *findHandler(const QString &type) const;
+
+    // 注册或替换一种请求类型，只应在开始分发前调用
+    void registerHandler(const QString &type, const HandlerDescriptor &descriptor);
+
+private:
+    void registerHandlers();
+
+    // 解析列表请求的 limit 与 cursor；stream 不为空时每块行作为 chunkType 帧推给它
+    template <typename T>
+    PageRequest<T> pageRequest(const QJsonObject &data, const QString &chunkType, ReplyStream *stream) const;
+
+    QJsonObject handleBatch(const QJsonObject &data) const;
+    QJsonObject handleGetServerStats(const QJsonObject &data) const;
+    QJsonObject handleLogin(const QJsonObject &data) const;
+    QJsonObject handleRegister(const QJsonObject &data) const;
+    QJsonObject handleCheckPhone(const QJsonObject &data) const;
+    QJsonObject handleCheckIdCard(const QJsonObject &data) const;
+    QJsonObject handleGetUserInfo(const QJsonObject &data) const;
+    QJsonObject handleChangePassword(const QJsonObject &data) const;
+    Reply handleGetFlights(const QJsonObject &data, ReplyStream *stream) const;
+    QJsonObject handleBookFlight(const QJsonObject &data) const;
+    QJsonObject handleGetSeatMap(const QJsonObject &data) const;
+    Reply handleGetOrders(const QJsonObject &data, ReplyStream *stream) const;
+    QJsonObject handleRefundOrder(const QJsonObject &data) const;
+    QJsonObject handleAddPassenger(const QJsonObject &data) const;
+    QJsonObject handleGetPassengers(const QJsonObject &data) const;
+    QJsonObject handleUpdatePassenger(const QJsonObject &data) const;
+    QJsonObject handleDeletePassenger(const QJsonObject &data) const;
+
+    DbHandler *m_dbHandler;
+    int m_maxBatchSize;
+    int m_maxInFlightRequests;
+    int m_busyRetryAfterMs;
+    int m_maxPageSize;
+    int m_streamChunkRows;
+    QHash<QString, HandlerDescriptor> m_handlers;
+};
+
+#endif // REQUESTDISPATCHER_H
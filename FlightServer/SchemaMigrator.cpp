@@ -0,0 +1,249 @@
+#include "SchemaMigrator.h"
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QRegularExpression>
+#include <QSet>
+#include <QDebug>
+
+SchemaMigrator::SchemaMigrator(DbConnectionPool::Lease &lease) : m_lease(lease) {}
+
+// 版本只增不改：要调整已发布的索引时追加新版本
+const QList<SchemaMigrator::Migration> &SchemaMigrator::migrations()
+{
+    static const QList<Migration> list = {
+        {1, "userdata: 登录、资料与注册查重", {
+            {"userdata", "idx_userdata_phone", {"phone"}},
+            {"userdata", "idx_userdata_username", {"username"}},
+            {"userdata", "idx_userdata_id_card", {"ID_card_number"}},
+        }},
+        {2, "orders: 退票、订单列表、已订航班与座位图", {
+            {"orders", "idx_orders_order_num", {"order_num"}},
+            // BookedFlightsByUser 只读索引即可得到结果
+            {"orders", "idx_orders_user_status", {"username", "status", "flight_id", "order_num"}},
+            // OrderList 的键集分页按 (create_time, order_num) 倒序
+            {"orders", "idx_orders_user_created", {"username", "create_time", "order_num"}},
+            {"orders", "idx_orders_flight_status", {"flight_id", "status", "seat"}},
+        }},
+        {3, "passengers: 按用户列出与身份证查重", {
+            {"passengers", "idx_passengers_user_id_card", {"username", "ID_card_number"}},
+        }},
+        {4, "flightdata: 航线查询与按航班号订票", {
+            {"flightdata", "idx_flightdata_route", {"from_city", "to_city", "date"}},
+            {"flightdata", "idx_flightdata_flight_num", {"flight_num"}},
+        }},
+    };
+    return list;
+}
+
+int SchemaMigrator::latestVersion()
+{
+    return migrations().isEmpty() ? 0 : migrations().last().version;
+}
+
+bool SchemaMigrator::scanExpected(SqlStatements::Id id)
+{
+    switch (id) {
+    case SqlStatements::LoadInventory:          // 启动时整表载入余票
+    case SqlStatements::ActiveSeats:            // 启动时重建全部座位图
+    case SqlStatements::FlightCatalogChecksum:  // 校验值本来就要读全表
+        return true;
+    default:
+        break;
+    }
+    // 不带出发城市的航班列表用不上 (from_city, to_city, date) 索引，结果由 FlightSearchCache 缓存
+    if (id >= SqlStatements::FlightList && id <= SqlStatements::FlightListLast)
+        return !((id - SqlStatements::FlightList) & SqlStatements::FilterFromCity);
+    return false;
+}
+
+bool SchemaMigrator::ensureVersionTable()
+{
+    QSqlQuery query(m_lease.database());
+    if (query.exec("CREATE TABLE IF NOT EXISTS schema_migrations ("
+                   "version INT NOT NULL PRIMARY KEY, "
+                   "description VARCHAR(255) NOT NULL, "
+                   "applied_at DATETIME NOT NULL)"))
+        return true;
+    qWarning() << "创建 schema_migrations 失败：" << query.lastError().text();
+    return false;
+}
+
+int SchemaMigrator::currentVersion()
+{
+    QSqlQuery query(m_lease.database());
+    if (query.exec("SELECT COALESCE(MAX(version), 0) FROM schema_migrations") && query.next())
+        return query.value(0).toInt();
+    return 0;
+}
+
+QHash<QString, QStringList> SchemaMigrator::indexesOf(const QString &table)
+{
+    auto cached = m_indexCache.constFind(table);
+    if (cached != m_indexCache.constEnd())
+        return cached.value();
+
+    QHash<QString, QStringList> indexes;
+    QSqlQuery query(m_lease.database());
+    query.prepare("SELECT index_name, column_name FROM information_schema.statistics "
+                  "WHERE table_schema = DATABASE() AND table_name = :table "
+                  "ORDER BY index_name, seq_in_index");
+    query.bindValue(":table", table);
+    if (query.exec()) {
+        while (query.next())
+            indexes[query.value(0).toString()].append(query.value(1).toString().toLower());
+    } else {
+        qWarning() << "读取" << table << "的索引失败：" << query.lastError().text();
+    }
+    m_indexCache.insert(table, indexes);
+    return indexes;
+}
+
+bool SchemaMigrator::hasIndex(const Index &index)
+{
+    const QHash<QString, QStringList> indexes = indexesOf(index.table);
+    for (const QStringList &columns : indexes) {
+        if (columns.size() < index.columns.size())
+            continue;
+        bool prefix = true;
+        for (int i = 0; i < index.columns.size() && prefix; ++i)
+            prefix = columns[i] == index.columns[i].toLower();
+        if (prefix)
+            return true;
+    }
+    return false;
+}
+
+bool SchemaMigrator::createIndex(const Index &index)
+{
+    QStringList columns;
+    for (const QString &column : index.columns)
+        columns << "`" + column + "`";
+    const QString sql = QString("ALTER TABLE `%1` ADD INDEX `%2` (%3)")
+                            .arg(QLatin1String(index.table), QLatin1String(index.name), columns.join(", "));
+
+    QSqlQuery query(m_lease.database());
+    if (!query.exec(sql)) {
+        qWarning() << "创建索引" << index.name << "失败：" << query.lastError().text();
+        return false;
+    }
+    m_indexCache.remove(index.table);
+    qInfo() << "已创建索引" << index.name << "于" << index.table << index.columns;
+    return true;
+}
+
+bool SchemaMigrator::run(bool apply)
+{
+    if (!m_lease.isValid())
+        return false;
+    if (apply && !ensureVersionTable())
+        return false;
+
+    const int current = currentVersion();
+    bool ok = true;
+    for (const Migration &migration : migrations()) {
+        bool complete = true;
+        for (const Index &index : migration.indexes) {
+            if (hasIndex(index))
+                continue;
+            if (!apply) {
+                qWarning() << "缺少索引" << index.name << "：" << index.table << index.columns;
+                complete = false;
+            } else if (!createIndex(index)) {
+                complete = false;
+            } else if (migration.version <= current) {
+                qWarning() << "版本" << migration.version << "的索引" << index.name << "曾被删除，已重建";
+            }
+        }
+        ok = ok && complete;
+
+        if (!apply || migration.version <= current)
+            continue;
+        // 版本号保持连续：前一个版本没有完成时不再执行后面的版本
+        if (!complete)
+            break;
+
+        QSqlQuery record(m_lease.database());
+        record.prepare("INSERT INTO schema_migrations (version, description, applied_at) "
+                       "VALUES (:version, :description, NOW())");
+        record.bindValue(":version", migration.version);
+        record.bindValue(":description", QString::fromUtf8(migration.description));
+        if (!record.exec()) {
+            qWarning() << "记录表结构版本" << migration.version << "失败：" << record.lastError().text();
+            ok = false;
+            break;
+        }
+        qInfo() << "表结构已迁移到版本" << migration.version << migration.description;
+    }
+
+    qInfo() << "表结构版本：" << (apply ? currentVersion() : current) << "/" << latestVersion()
+            << (ok ? "索引齐全" : "索引不完整");
+    return ok;
+}
+
+int SchemaMigrator::explainStatements()
+{
+    static const QRegularExpression placeholder(":([A-Za-z_][A-Za-z0-9_]*)");
+    QSqlDatabase db = m_lease.database();
+    int unexpected = 0;
+
+    for (int i = 0; i < SqlStatements::Count; ++i) {
+        const SqlStatements::Id id = SqlStatements::Id(i);
+        const QString sql = SqlStatements::text(id);
+        if (sql.isEmpty())
+            continue;
+
+        QSqlQuery query(db);
+        if (!query.prepare("EXPLAIN " + sql)) {
+            qWarning().noquote() << SqlStatements::name(id) << "EXPLAIN 预编译失败：" << query.lastError().text();
+            continue;
+        }
+        // 参数值不影响执行计划的选择方式，只需类型合适：LIMIT 要整数，其余按字符串绑定
+        QSet<QString> bound;
+        QRegularExpressionMatchIterator it = placeholder.globalMatch(sql);
+        while (it.hasNext()) {
+            const QString name = ":" + it.next().captured(1);
+            if (bound.contains(name))
+                continue;
+            bound.insert(name);
+            query.bindValue(name, name == ":limit" ? QVariant(10) : QVariant(QString("0")));
+        }
+        if (!query.exec()) {
+            qWarning().noquote() << SqlStatements::name(id) << "EXPLAIN 失败：" << query.lastError().text();
+            continue;
+        }
+
+        const QSqlRecord record = query.record();
+        const int tableCol = record.indexOf("table");
+        const int typeCol = record.indexOf("type");
+        const int keyCol = record.indexOf("key");
+        const int rowsCol = record.indexOf("rows");
+        const int extraCol = record.indexOf("Extra");
+
+        bool fullScan = false;
+        QStringList plan;
+        while (query.next()) {
+            const QString type = query.value(typeCol).toString();
+            // ALL 为全表扫描，index 为整个索引的扫描，代价同样随表大小增长
+            if (type == "ALL" || type == "index")
+                fullScan = true;
+            plan << QString("%1[%2 key=%3 rows=%4%5]")
+                        .arg(query.value(tableCol).toString(), type,
+                             query.value(keyCol).isNull() ? "-" : query.value(keyCol).toString(),
+                             query.value(rowsCol).toString(),
+                             extraCol >= 0 && !query.value(extraCol).toString().isEmpty()
+                                 ? " " + query.value(extraCol).toString() : QString());
+        }
+
+        const QString line = SqlStatements::name(id) + "：" + plan.join(" ");
+        if (fullScan && !scanExpected(id)) {
+            ++unexpected;
+            qWarning().noquote() << "全表扫描" << line;
+        } else {
+            qInfo().noquote() << (fullScan ? "全表扫描（预期）" : "使用索引") << line;
+        }
+    }
+
+    qInfo() << "EXPLAIN 完成，意外的全表扫描：" << unexpected << "条语句";
+    return unexpected;
+}
@@ -0,0 +1,55 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include "DbConnectionPool.h"
+#include "SqlStatements.h"
+
+// 启动时的表结构迁移。已执行的版本记在 schema_migrations 表中，每个版本是一组
+// SqlStatements 中查询所需的索引；索引按列前缀校验，库中已有等价索引（名字不同也算）时不再创建。
+// MySQL 的 DDL 会隐式提交，因此每个版本的索引建好后才记录版本号，中途失败下次启动会重试
+class SchemaMigrator
+{
+public:
+    explicit SchemaMigrator(DbConnectionPool::Lease &lease);
+
+    // apply 为 false 时只报告缺少的索引，不修改表结构。返回 false 表示有索引缺失或创建失败
+    bool run(bool apply);
+
+    // 已记录的最高版本，表不存在时为 0
+    int currentVersion();
+    static int latestVersion();
+
+    // 对 SqlStatements 中的每条语句执行 EXPLAIN，打印各表的访问方式，
+    // 返回意外全表扫描的语句数（启动时整表载入等有意的扫描不计）
+    int explainStatements();
+
+private:
+    struct Index {
+        const char *table;
+        const char *name;
+        QStringList columns;
+    };
+    struct Migration {
+        int version;
+        const char *description;
+        QList<Index> indexes;
+    };
+
+    static const QList<Migration> &migrations();
+    // 是否是本来就要读整张表（或筛选条件用不上索引且由缓存兜底）的语句
+    static bool scanExpected(SqlStatements::Id id);
+
+    bool ensureVersionTable();
+    // 库中已有以 index.columns 为前缀的索引
+    bool hasIndex(const Index &index);
+    bool createIndex(const Index &index);
+    QHash<QString, QStringList> indexesOf(const QString &table);
+
+    DbConnectionPool::Lease &m_lease;
+    QHash<QString, QHash<QString, QStringList>> m_indexCache;   // 表 -> 索引名 -> 列
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -0,0 +1,268 @@
+#include "SeatInventory.h"
+#include "ServerStats.h"
+#include <QSqlQuery>
+#include <QThread>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QStringList>
+#include <QDebug>
+
+// 写线程被唤醒后稍等片刻，让热点航班上的连续变化合并进同一批
+static constexpr unsigned long kCoalesceMs = 20;
+// 写回失败后隔多久重试
+static constexpr unsigned long kRetryDelayMs = 1000;
+
+SeatInventory::~SeatInventory()
+{
+    stopWriter();
+}
+
+SeatInventory::Batch SeatInventory::read(QSqlQuery &query)
+{
+    Batch batch;
+    while (query.next()) {
+        auto flight = std::make_unique<Flight>();
+        flight->id = query.value(0).toInt();
+        flight->flightNum = query.value(1).toString();
+        flight->fromCity = query.value(2).toString();
+        flight->toCity = query.value(3).toString();
+        flight->date = query.value(4).toString();
+        flight->price = query.value(5).toString();
+        flight->remaining.store(query.value(6).toInt(), std::memory_order_relaxed);
+        batch.push_back(std::move(flight));
+    }
+    return batch;
+}
+
+int SeatInventory::loadSeats(Batch &batch, QSqlQuery &query)
+{
+    QHash<int, Flight *> byId;
+    byId.reserve(qsizetype(batch.size()));
+    for (const auto &flight : batch)
+        byId.insert(flight->id, flight.get());
+
+    int conflicts = 0;
+    while (query.next()) {
+        Flight *flight = byId.value(query.value(0).toInt(), nullptr);
+        const int index = SeatMap::seatIndex(query.value(1).toString());
+        if (!flight || index < 0)
+            continue;
+        // 旧版本随机选座可能把同一座位分给两个订单，记下多出的持有者，退票时不误放座位
+        if (!flight->seats.occupy(index)) {
+            ++flight->sharedSeats[index];
+            flight->sharedCount.fetch_add(1, std::memory_order_relaxed);
+            ++conflicts;
+        }
+    }
+    ServerStats::instance().seatConflicts.fetch_add(conflicts, std::memory_order_relaxed);
+    return conflicts;
+}
+
+int SeatInventory::publish(Batch &batch)
+{
+    int added = 0;
+    QList<Delta> clamped;
+    {
+        QWriteLocker locker(&m_lock);
+        for (auto &flight : batch) {
+            if (m_byId.contains(flight->id))
+                continue;
+
+            // 数据库里的余票与订单对不上时以座位图为准，否则会出现有余票却分不到座位
+            const int free = SeatMap::kSeats - flight->seats.occupiedCount()
+                             - flight->sharedCount.load(std::memory_order_relaxed);
+            Flight *raw = flight.get();
+            const int remaining = raw->remaining.load(std::memory_order_relaxed);
+            if (remaining > free) {
+                raw->remaining.store(qMax(0, free), std::memory_order_relaxed);
+                clamped.append(Delta{raw->id, qMax(0, free) - remaining});
+            }
+
+            m_flights.push_back(std::move(flight));
+            m_byNumber.insert(raw->flightNum, raw);
+            m_byId.insert(raw->id, raw);
+            ++added;
+        }
+    }
+    batch.clear();
+
+    // 差值经写线程写回，数据库的余票随之与座位图一致
+    for (const Delta &delta : std::as_const(clamped))
+        enqueueDelta(find(delta.flightId), delta.delta);
+    if (!clamped.isEmpty())
+        qWarning() << clamped.size() << "个航班的余票多于座位图上的空座，已按空座数计并写回数据库";
+    ServerStats::instance().inventoryFlights.store(size(), std::memory_order_relaxed);
+    return added;
+}
+
+SeatInventory::Flight *SeatInventory::find(const QString &flightNum) const
+{
+    QReadLocker locker(&m_lock);
+    return m_byNumber.value(flightNum, nullptr);
+}
+
+SeatInventory::Flight *SeatInventory::find(int flightId) const
+{
+    QReadLocker locker(&m_lock);
+    return m_byId.value(flightId, nullptr);
+}
+
+int SeatInventory::size() const
+{
+    QReadLocker locker(&m_lock);
+    return int(m_flights.size());
+}
+
+bool SeatInventory::reserve(Flight *flight)
+{
+    ServerStats &stats = ServerStats::instance();
+    int remaining = flight->remaining.load(std::memory_order_relaxed);
+    while (remaining > 0) {
+        if (flight->remaining.compare_exchange_weak(remaining, remaining - 1, std::memory_order_acq_rel,
+                                                    std::memory_order_relaxed)) {
+            stats.inventoryReserves.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    stats.inventorySoldOut.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void SeatInventory::confirm(Flight *flight)
+{
+    enqueueDelta(flight, -1);
+}
+
+void SeatInventory::cancel(Flight *flight)
+{
+    flight->remaining.fetch_add(1, std::memory_order_acq_rel);
+}
+
+bool SeatInventory::release(Flight *flight, int seatIndex)
+{
+    if (!releaseShared(flight, seatIndex) && !flight->seats.release(seatIndex))
+        return false;
+    flight->remaining.fetch_add(1, std::memory_order_acq_rel);
+    enqueueDelta(flight, +1);
+    return true;
+}
+
+bool SeatInventory::releaseShared(Flight *flight, int seatIndex)
+{
+    if (flight->sharedCount.load(std::memory_order_acquire) == 0)
+        return false;
+    QMutexLocker locker(&flight->sharedMutex);
+    auto it = flight->sharedSeats.find(seatIndex);
+    if (it == flight->sharedSeats.end())
+        return false;
+    if (--it.value() == 0)
+        flight->sharedSeats.erase(it);
+    flight->sharedCount.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void SeatInventory::enqueueDelta(Flight *flight, int delta)
+{
+    flight->pendingDelta.fetch_add(delta);
+    // 写线程先清 queued 再取走 pendingDelta，所以这里看到 queued 为 false 时必须重新入队
+    if (!flight->queued.exchange(true)) {
+        QMutexLocker locker(&m_queueMutex);
+        m_dirty.enqueue(flight);
+        m_queueReady.wakeOne();
+    }
+}
+
+void SeatInventory::startWriter(Persist persist, std::function<void()> onExit)
+{
+    if (m_writer)
+        return;
+    m_persist = std::move(persist);
+    m_onExit = std::move(onExit);
+    m_stopping = false;
+    m_writer = QThread::create([this]() {
+        runWriter();
+        if (m_onExit)
+            m_onExit();
+    });
+    m_writer->setObjectName("seat_writer");
+    m_writer->start();
+}
+
+void SeatInventory::stopWriter()
+{
+    if (!m_writer)
+        return;
+    {
+        QMutexLocker locker(&m_queueMutex);
+        m_stopping = true;
+        m_stopDeadline = QDeadlineTimer(kStopFlushMs);
+        m_queueReady.wakeAll();
+    }
+    m_writer->wait();
+    delete m_writer;
+    m_writer = nullptr;
+}
+
+void SeatInventory::runWriter()
+{
+    ServerStats &stats = ServerStats::instance();
+    QMutexLocker locker(&m_queueMutex);
+    for (;;) {
+        while (m_dirty.isEmpty() && !m_stopping)
+            m_queueReady.wait(&m_queueMutex);
+        if (m_dirty.isEmpty())
+            break;
+
+        if (!m_stopping) {
+            locker.unlock();
+            QThread::msleep(kCoalesceMs);
+            locker.relock();
+        }
+
+        QQueue<Flight *> batch;
+        batch.swap(m_dirty);
+        locker.unlock();
+
+        // 按入队顺序取走每个航班累计的变化，同一航班的多次订退合并为一条 UPDATE
+        QList<Flight *> flights;
+        QList<Delta> deltas;
+        for (Flight *flight : std::as_const(batch)) {
+            flight->queued.store(false);
+            const int delta = flight->pendingDelta.exchange(0);
+            if (delta != 0) {
+                flights.append(flight);
+                deltas.append(Delta{flight->id, delta});
+            }
+        }
+
+        bool ok = true;
+        if (!deltas.isEmpty()) {
+            ok = m_persist(deltas);
+            stats.inventoryWriteBatches.fetch_add(1, std::memory_order_relaxed);
+            if (ok)
+                stats.inventoryRowsWritten.fetch_add(deltas.size(), std::memory_order_relaxed);
+            else
+                stats.inventoryWriteFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (ok) {
+            locker.relock();
+            continue;
+        }
+
+        // 整批放回，等一会儿再试；正在关闭时也照样重试，直到 kStopFlushMs 用完才放弃，以免卡住退出
+        for (int i = 0; i < flights.size(); ++i)
+            enqueueDelta(flights[i], deltas[i].delta);
+        locker.relock();
+        if (m_stopping && m_stopDeadline.hasExpired()) {
+            QStringList lost;
+            for (const Flight *flight : std::as_const(m_dirty))
+                lost << QString("%1(%2)").arg(flight->flightNum).arg(flight->pendingDelta.load());
+            qCritical().noquote() << "余票写回失败，放弃" << m_dirty.size() << "个航班的变化，"
+                                  << "数据库余票需按未退票订单核对：" << lost.join(", ");
+            break;
+        }
+        m_queueReady.wait(&m_queueMutex, kRetryDelayMs);
+    }
+}
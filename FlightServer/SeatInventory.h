@@ -0,0 +1,118 @@
+#ifndef SEATINVENTORY_H
+#define SEATINVENTORY_H
+
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QWaitCondition>
+#include <QDeadlineTimer>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include "SeatMap.h"
+
+class QSqlQuery;
+class QThread;
+
+// 进程内的权威余票表：启动时从 flightdata 载入，订票、退票只对内存中的原子计数做 CAS，
+// 余票变化按航班合并后由后台写线程批量写回数据库（write-behind）
+class SeatInventory
+{
+public:
+    // 关闭时剩余变化写回失败后最多再重试这么久
+    static constexpr int kStopFlushMs = 15 * 1000;
+
+    struct Flight {
+        int id = 0;
+        QString flightNum;
+        QString fromCity;
+        QString toCity;
+        QString date;
+        QString price;
+        std::atomic<int> remaining{0};
+        SeatMap seats;
+
+        // 旧版本随机选座留下的重复占用：座位 -> 除第一个订单外仍占着它的订单数。
+        // 发布前建好，之后只在退票时减少；sharedCount 为其总和，为 0 时退票不必加锁
+        QMutex sharedMutex;
+        QHash<int, int> sharedSeats;
+        std::atomic<int> sharedCount{0};
+
+        // 以下由写回逻辑使用
+        std::atomic<int> pendingDelta{0};   // 尚未写入数据库的余票变化
+        std::atomic<bool> queued{false};    // 已在写回队列中
+    };
+
+    // 一个航班待写回的余票变化
+    struct Delta {
+        int flightId = 0;
+        int delta = 0;
+    };
+
+    // 在写线程中把一批变化写入数据库，全部成功返回 true；失败的批次稍后整体重试
+    using Persist = std::function<bool(const QList<Delta> &deltas)>;
+
+    SeatInventory() = default;
+    ~SeatInventory();
+
+    SeatInventory(const SeatInventory &) = delete;
+    SeatInventory &operator=(const SeatInventory &) = delete;
+
+    // 载入分三步：read 读出航班，loadSeats 按未退票订单重建它们的座位图，publish 之后 find 才查得到，
+    // 因此其他线程拿到的航班座位图总是完整的
+    using Batch = std::vector<std::unique_ptr<Flight>>;
+    // 从已执行的查询中读出航班，列顺序：id, flight_num, from_city, to_city, date, price, remaining
+    static Batch read(QSqlQuery &query);
+    // 列顺序：flight_id, seat；不属于 batch 的行忽略。返回被重复占用的座位数
+    static int loadSeats(Batch &batch, QSqlQuery &query);
+    // 余票不超过座位图上的空座（减去重复占用），reserve 成功后 allocate 就一定有座。
+    // 已载入的航班不会被覆盖，返回新增的航班数；batch 随后清空
+    int publish(Batch &batch);
+
+    // 线程安全；返回的指针在本对象析构前一直有效
+    Flight *find(const QString &flightNum) const;
+    Flight *find(int flightId) const;
+    int size() const;
+
+    // 预留一个座位，余票为 0 时返回 false。只做 CAS，不加锁
+    bool reserve(Flight *flight);
+    // 订单已落库，把预留记为一次待写回的 -1
+    void confirm(Flight *flight);
+    // 订单没建成，撤销预留，不产生写回
+    void cancel(Flight *flight);
+    // 退票归还 seatIndex，记为一次待写回的 +1；座位仍被其他未退票的订单占着时只减少重复计数。
+    // 座位号无效或座位本就空着时余票不变（否则余票会多于空座），返回 false
+    bool release(Flight *flight, int seatIndex);
+
+    // 启动写线程；stopWriter 会先把剩余变化写完再返回，写回失败时继续重试，最多等 kStopFlushMs。onExit 在写线程退出前于该线程上调用，
+    // 用来释放只能在本线程关闭的资源（如连接池中属于该线程的连接）
+    void startWriter(Persist persist, std::function<void()> onExit = {});
+    void stopWriter();
+
+private:
+    // 座位被重复占用时减去一个持有者并返回 true，此时位图不变
+    static bool releaseShared(Flight *flight, int seatIndex);
+    void enqueueDelta(Flight *flight, int delta);
+    void runWriter();
+
+    mutable QReadWriteLock m_lock;
+    std::vector<std::unique_ptr<Flight>> m_flights;
+    QHash<QString, Flight *> m_byNumber;
+    QHash<int, Flight *> m_byId;
+
+    // 写回队列：航班第一次变脏时入队，同一航班在队列里只出现一次
+    QMutex m_queueMutex;
+    QWaitCondition m_queueReady;
+    QQueue<Flight *> m_dirty;
+    bool m_stopping = false;
+    QDeadlineTimer m_stopDeadline;      // 关闭时写回重试的截止时间
+    Persist m_persist;
+    std::function<void()> m_onExit;
+    QThread *m_writer = nullptr;
+};
+
+#endif // SEATINVENTORY_H
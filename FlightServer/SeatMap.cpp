@@ -0,0 +1,133 @@
+#include "SeatMap.h"
+#include <QtAlgorithms>
+
+namespace {
+// 每个字中属于指定列（按位：A=1, B=2, ... F=32）的座位
+struct WordMasks {
+    quint64 words[SeatMap::kWords];
+};
+
+constexpr WordMasks makeMasks(unsigned columns)
+{
+    WordMasks masks{};
+    for (int index = 0; index < SeatMap::kSeats; ++index) {
+        if ((columns >> (index % SeatMap::kSeatsPerRow)) & 1u)
+            masks.words[index / 64] |= quint64(1) << (index % 64);
+    }
+    return masks;
+}
+
+constexpr WordMasks kAnyMasks = makeMasks(0x3F);      // A-F
+constexpr WordMasks kWindowMasks = makeMasks(0x21);   // A F
+constexpr WordMasks kAisleMasks = makeMasks(0x0C);    // C D
+constexpr WordMasks kMiddleMasks = makeMasks(0x12);   // B E
+}
+
+bool SeatMap::preferenceFromName(const QString &name, Preference &preference)
+{
+    if (name.isEmpty() || name == "any") {
+        preference = AnySeat;
+    } else if (name == "window") {
+        preference = Window;
+    } else if (name == "aisle") {
+        preference = Aisle;
+    } else if (name == "middle") {
+        preference = Middle;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QString SeatMap::seatLabel(int index)
+{
+    if (index < 0 || index >= kSeats)
+        return QString();
+    return QString("%1%2").arg(index / kSeatsPerRow + 1).arg(QChar('A' + index % kSeatsPerRow));
+}
+
+int SeatMap::seatIndex(const QString &label)
+{
+    const QString seat = label.trimmed().toUpper();
+    if (seat.size() < 2)
+        return -1;
+
+    const int column = seat.back().unicode() - 'A';
+    bool ok = false;
+    const int row = QStringView(seat).chopped(1).toInt(&ok);
+    if (!ok || row < 1 || row > kRows || column < 0 || column >= kSeatsPerRow)
+        return -1;
+    return (row - 1) * kSeatsPerRow + column;
+}
+
+int SeatMap::allocate(Preference preference)
+{
+    int index = -1;
+    switch (preference) {
+    case Window:
+        index = allocateMasked(kWindowMasks.words);
+        break;
+    case Aisle:
+        index = allocateMasked(kAisleMasks.words);
+        break;
+    case Middle:
+        index = allocateMasked(kMiddleMasks.words);
+        break;
+    case AnySeat:
+        break;
+    }
+    if (index < 0)
+        index = allocateMasked(kAnyMasks.words);
+    return index;
+}
+
+int SeatMap::allocateMasked(const quint64 *masks)
+{
+    for (int w = 0; w < kWords; ++w) {
+        quint64 word = m_words[w].load(std::memory_order_relaxed);
+        quint64 free = ~word & masks[w];
+        while (free) {
+            // 取最低的空位，CAS 失败时 word 已更新为最新值，重新计算
+            const quint64 bit = free & (~free + 1);
+            if (m_words[w].compare_exchange_weak(word, word | bit, std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed))
+                return w * 64 + int(qCountTrailingZeroBits(bit));
+            free = ~word & masks[w];
+        }
+    }
+    return -1;
+}
+
+bool SeatMap::occupy(int index)
+{
+    if (index < 0 || index >= kSeats)
+        return false;
+    const quint64 bit = quint64(1) << (index % 64);
+    return !(m_words[index / 64].fetch_or(bit, std::memory_order_acq_rel) & bit);
+}
+
+bool SeatMap::release(int index)
+{
+    if (index < 0 || index >= kSeats)
+        return false;
+    const quint64 bit = quint64(1) << (index % 64);
+    return m_words[index / 64].fetch_and(~bit, std::memory_order_acq_rel) & bit;
+}
+
+int SeatMap::occupiedCount() const
+{
+    int count = 0;
+    for (int w = 0; w < kWords; ++w)
+        count += qPopulationCount(m_words[w].load(std::memory_order_relaxed));
+    return count;
+}
+
+QByteArray SeatMap::toBytes() const
+{
+    QByteArray bytes((kSeats + 7) / 8, '\0');
+    for (int i = 0; i < bytes.size(); ++i) {
+        const quint64 word = m_words[i / 8].load(std::memory_order_relaxed);
+        bytes[i] = char((word >> ((i % 8) * 8)) & 0xFF);
+    }
+    return bytes;
+}
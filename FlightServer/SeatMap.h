@@ -0,0 +1,50 @@
+#ifndef SEATMAP_H
+#define SEATMAP_H
+
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+
+// 一个航班的座位占用位图：30 排 × A-F 六座，第 i 位对应第 i/6+1 排第 i%6 列（A 起）。
+// A/F 靠窗，C/D 靠过道，B/E 为中间座。占座与释放都是对单个 64 位字的 CAS，可多线程并发
+class SeatMap
+{
+public:
+    static constexpr int kRows = 30;
+    static constexpr int kSeatsPerRow = 6;
+    static constexpr int kSeats = kRows * kSeatsPerRow;
+    static constexpr int kWords = (kSeats + 63) / 64;
+
+    enum Preference {
+        AnySeat,
+        Window,
+        Aisle,
+        Middle
+    };
+
+    // 空字符串、"any" 为不限；不认识的名称返回 false
+    static bool preferenceFromName(const QString &name, Preference &preference);
+
+    // 座位号与位序号互转，如 "12C" <-> 68；无效座位号返回 -1
+    static QString seatLabel(int index);
+    static int seatIndex(const QString &label);
+
+    // 分配一个空座，优先满足偏好，偏好的座位没有了再任选；已满返回 -1
+    int allocate(Preference preference);
+    // 占用指定座位（启动时按订单重建），已被占用返回 false
+    bool occupy(int index);
+    // 释放指定座位，原本空着或座位号无效时返回 false
+    bool release(int index);
+
+    int occupiedCount() const;
+
+    // 按位序号从低到高、每字节低位在前打包，共 (kSeats + 7) / 8 字节
+    QByteArray toBytes() const;
+
+private:
+    int allocateMasked(const quint64 *masks);
+
+    std::atomic<quint64> m_words[kWords] = {};
+};
+
+#endif // SEATMAP_H
@@ -0,0 +1,90 @@
+#ifndef SERVERCONFIG_H
+#define SERVERCONFIG_H
+
+#include <QThread>
+#include <QString>
+
+// 服务器运行参数，由 main 解析命令行后传给各模块
+struct ServerConfig {
+    // 连接 I/O 后端：Qt 套接字（各平台可用）或 Linux 下边沿触发的 epoll 反应器
+    enum class IoBackend {
+        Qt,
+        Epoll
+    };
+
+    quint16 port = 8888;
+
+    // 接收连接的线程数，大于 1 时在同一端口上开启多个 SO_REUSEPORT 监听套接字（仅类 Unix 系统）
+    int acceptorThreads = 1;
+
+    // I/O 工作线程数，每个线程用一个事件循环（或 epoll 反应器）复用多个连接
+    int ioThreads = QThread::idealThreadCount();
+    IoBackend ioBackend = IoBackend::Qt;
+
+    // 所有访问数据库的请求都在此线程池中执行，每个线程持有自己的数据库连接
+    int dbThreads = QThread::idealThreadCount();
+
+    // 数据库连接池：常驻连接数、上限（0 表示数据库线程数 + 1）、检出等待超时与空闲回收时间
+    int dbPoolMin = 2;
+    int dbPoolMax = 0;
+    int dbCheckoutTimeoutMs = 5000;
+    int dbIdleTimeoutMs = 5 * 60 * 1000;
+
+    // 启动时的表结构检查：Migrate 创建缺少的索引并记录版本，Verify 只报告缺少的索引，Off 跳过
+    enum class SchemaCheck {
+        Off,
+        Verify,
+        Migrate
+    };
+    SchemaCheck schemaCheck = SchemaCheck::Migrate;
+    // 对全部语句执行 EXPLAIN、报告全表扫描后退出，不启动服务
+    bool explainStatements = false;
+
+    // 开始监听前预热的数据库连接数（0 为连接池常驻连接数），每个连接预编译全部语句；
+    // warmupQueriesFile 为要回放的只读请求（JSON 数组），用来预先填充航班缓存和数据库缓存
+    int warmupConnections = 0;
+    QString warmupQueriesFile;
+
+    // 航班查询缓存的路线数上限（0 关闭缓存），以及校验航班目录是否被外部改动的间隔
+    int flightCacheEntries = 1024;
+    int flightCacheCheckMs = 5000;
+
+    // 准入控制：并发连接数与在途请求数上限，超过时立即回复 server_busy（0 表示不限）
+    int maxConnections = 10000;
+    int maxInFlightRequests = 512;
+    // server_busy 回复中建议客户端的重试间隔
+    int busyRetryAfterMs = 1000;
+
+    // get_flights / get_user_orders 分页时每页行数上限（0 不限），以及流式回复每帧的行数
+    int maxPageSize = 500;
+    int streamChunkRows = 100;
+
+    // batch 请求中子请求的最大数量
+    int maxBatchSize = 32;
+
+    // 不带 req_id 的请求按顺序逐个执行，每个连接排队的请求超过此数时暂停读取
+    int maxQueuedRequests = 64;
+
+    // 单帧最大字节数，超过即视为异常连接
+    quint32 maxFrameSize = 1024 * 1024;
+
+    // 每个连接待发送字节数超过高水位时暂停读取，降到低水位以下恢复
+    qint64 writeHighWaterMark = 1024 * 1024;
+    qint64 writeLowWaterMark = 256 * 1024;
+    // 待发送字节数的硬上限，超过即断开连接
+    qint64 maxPendingWriteBytes = 16 * 1024 * 1024;
+
+    // 连接无数据超过心跳间隔时发送 ping，超过空闲超时则关闭；
+    // 未完成的帧超过半包超时也会关闭（防 slowloris）。0 表示关闭对应检查
+    qint64 heartbeatIntervalMs = 30 * 1000;
+    qint64 idleTimeoutMs = 90 * 1000;
+    qint64 partialFrameTimeoutMs = 10 * 1000;
+    // 每个工作线程时间轮的刻度
+    int timerTickMs = 100;
+
+    // 套接字内核收发缓冲区大小，0 表示使用系统默认值
+    int socketSendBufferSize = 0;
+    int socketReceiveBufferSize = 0;
+};
+
+#endif // SERVERCONFIG_H
@@ -0,0 +1,137 @@
+#include "ServerStats.h"
+#include <QDateTime>
+
+ServerStats &ServerStats::instance()
+{
+    static ServerStats stats;
+    return stats;
+}
+
+void ServerStats::setLimits(qint64 maxConnections, qint64 maxInFlightRequests)
+{
+    m_maxConnections = maxConnections;
+    m_maxInFlightRequests = maxInFlightRequests;
+}
+
+void ServerStats::setDbPoolLimits(qint64 minSize, qint64 maxSize)
+{
+    m_dbPoolMin = minSize;
+    m_dbPoolMax = maxSize;
+}
+
+void ServerStats::setFlightCacheLimits(qint64 maxEntries, qint64 checkIntervalMs)
+{
+    m_flightCacheMax = maxEntries;
+    m_flightCacheCheckMs = checkIntervalMs;
+}
+
+void ServerStats::setWarmUp(qint64 elapsedMs, qint64 connections, qint64 queries)
+{
+    m_warmUpMs = elapsedMs;
+    m_warmUpConnections = connections;
+    m_warmUpQueries = queries;
+}
+
+QJsonObject ServerStats::toJson() const
+{
+    QJsonObject connections{
+        {"accepted", connectionsAccepted.load(std::memory_order_relaxed)},
+        {"active", connectionsActive.load(std::memory_order_relaxed)},
+        {"reaped", connectionsReaped.load(std::memory_order_relaxed)},
+        {"rejected", connectionsRejected.load(std::memory_order_relaxed)},
+        {"limit", m_maxConnections}
+    };
+
+    QJsonObject requests{
+        {"in_flight", requestsInFlight.load(std::memory_order_relaxed)},
+        {"rejected", requestsRejected.load(std::memory_order_relaxed)},
+        {"limit", m_maxInFlightRequests}
+    };
+
+    const qint64 checkouts = dbCheckouts.load(std::memory_order_relaxed);
+    const qint64 inUse = dbConnectionsInUse.load(std::memory_order_relaxed);
+    QJsonObject dbPool{
+        {"open", dbConnectionsOpen.load(std::memory_order_relaxed)},
+        {"in_use", inUse},
+        {"min", m_dbPoolMin},
+        {"max", m_dbPoolMax},
+        {"utilization", m_dbPoolMax > 0 ? double(inUse) / double(m_dbPoolMax) : 0.0},
+        {"created", dbConnectionsCreated.load(std::memory_order_relaxed)},
+        {"broken", dbConnectionsBroken.load(std::memory_order_relaxed)},
+        {"evicted", dbConnectionsEvicted.load(std::memory_order_relaxed)},
+        {"checkouts", checkouts},
+        {"checkout_timeouts", dbCheckoutTimeouts.load(std::memory_order_relaxed)},
+        {"avg_wait_us", checkouts > 0 ? dbCheckoutWaitUs.load(std::memory_order_relaxed) / checkouts : 0},
+        {"max_wait_us", dbCheckoutWaitMaxUs.load(std::memory_order_relaxed)}
+    };
+
+    const qint64 statementHits = dbStatementHits.load(std::memory_order_relaxed);
+    const qint64 statementPrepares = dbStatementPrepares.load(std::memory_order_relaxed);
+    dbPool["statements"] = QJsonObject{
+        {"hits", statementHits},
+        {"prepares", statementPrepares},
+        {"hit_ratio", statementHits + statementPrepares > 0
+                          ? double(statementHits) / double(statementHits + statementPrepares) : 0.0}
+    };
+
+    QJsonObject inventory{
+        {"flights", inventoryFlights.load(std::memory_order_relaxed)},
+        {"reserves", inventoryReserves.load(std::memory_order_relaxed)},
+        {"sold_out", inventorySoldOut.load(std::memory_order_relaxed)},
+        {"write_batches", inventoryWriteBatches.load(std::memory_order_relaxed)},
+        {"rows_written", inventoryRowsWritten.load(std::memory_order_relaxed)},
+        {"write_failures", inventoryWriteFailures.load(std::memory_order_relaxed)},
+        {"seat_conflicts", seatConflicts.load(std::memory_order_relaxed)}
+    };
+
+    // 外部改动航班目录后，缓存最多滞后一个校验周期；last_check_age_ms 为距上次校验的时间
+    const qint64 cacheHits = flightCacheHits.load(std::memory_order_relaxed);
+    const qint64 cacheMisses = flightCacheMisses.load(std::memory_order_relaxed);
+    const qint64 lastCheck = flightCacheLastCheckMs.load(std::memory_order_relaxed);
+    QJsonObject flightCache{
+        {"entries", flightCacheEntries.load(std::memory_order_relaxed)},
+        {"max_entries", m_flightCacheMax},
+        {"hits", cacheHits},
+        {"misses", cacheMisses},
+        {"hit_ratio", cacheHits + cacheMisses > 0 ? double(cacheHits) / double(cacheHits + cacheMisses) : 0.0},
+        {"invalidations", flightCacheInvalidations.load(std::memory_order_relaxed)},
+        {"checks", flightCacheChecks.load(std::memory_order_relaxed)},
+        {"check_interval_ms", m_flightCacheCheckMs},
+        {"last_check_age_ms", lastCheck > 0 ? QDateTime::currentMSecsSinceEpoch() - lastCheck : qint64(-1)}
+    };
+
+    QJsonObject bookedIndex{
+        {"users", bookedIndexUsers.load(std::memory_order_relaxed)},
+        {"hits", bookedIndexHits.load(std::memory_order_relaxed)},
+        {"loads", bookedIndexLoads.load(std::memory_order_relaxed)}
+    };
+
+    QJsonObject streams{
+        {"started", streamsStarted.load(std::memory_order_relaxed)},
+        {"chunks", streamChunks.load(std::memory_order_relaxed)},
+        {"aborted", streamsAborted.load(std::memory_order_relaxed)}
+    };
+
+    QJsonObject subscriptions{
+        {"active", subscriptionsActive.load(std::memory_order_relaxed)},
+        {"updates_pushed", flightUpdatesPushed.load(std::memory_order_relaxed)}
+    };
+
+    QJsonObject warmUp{
+        {"elapsed_ms", m_warmUpMs},
+        {"connections", m_warmUpConnections},
+        {"queries", m_warmUpQueries}
+    };
+
+    return QJsonObject{
+        {"warm_up", warmUp},
+        {"connections", connections},
+        {"requests", requests},
+        {"db_pool", dbPool},
+        {"inventory", inventory},
+        {"flight_cache", flightCache},
+        {"booked_index", bookedIndex},
+        {"streams", streams},
+        {"subscriptions", subscriptions}
+    };
+}
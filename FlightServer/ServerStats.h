@@ -0,0 +1,87 @@
+#ifndef SERVERSTATS_H
+#define SERVERSTATS_H
+
+#include <QJsonObject>
+#include <atomic>
+
+// 进程级运行统计，各线程直接原子累加，通过 get_server_stats 请求查看
+class ServerStats
+{
+public:
+    static ServerStats &instance();
+
+    std::atomic<qint64> connectionsAccepted{0};
+    std::atomic<qint64> connectionsActive{0};
+    std::atomic<qint64> connectionsReaped{0};   // 因空闲或半包超时被服务端关闭的连接
+    std::atomic<qint64> connectionsRejected{0}; // 超过连接上限而被拒绝
+
+    std::atomic<qint64> requestsInFlight{0};
+    std::atomic<qint64> requestsRejected{0};    // 超过在途请求上限而返回 server_busy
+
+    // 数据库连接池
+    std::atomic<qint64> dbConnectionsOpen{0};
+    std::atomic<qint64> dbConnectionsInUse{0};
+    std::atomic<qint64> dbConnectionsCreated{0};
+    std::atomic<qint64> dbConnectionsBroken{0};   // 校验失败或出现连接级错误而被丢弃
+    std::atomic<qint64> dbConnectionsEvicted{0};  // 为其他线程腾位置而关闭
+    std::atomic<qint64> dbCheckouts{0};
+    std::atomic<qint64> dbCheckoutTimeouts{0};
+    std::atomic<qint64> dbCheckoutWaitUs{0};      // 检出等待时间累计
+    std::atomic<qint64> dbCheckoutWaitMaxUs{0};
+    std::atomic<qint64> dbStatementHits{0};       // 复用已缓存的预编译语句
+    std::atomic<qint64> dbStatementPrepares{0};   // 缓存未命中，新 prepare
+
+    // 内存余票表
+    std::atomic<qint64> inventoryFlights{0};
+    std::atomic<qint64> inventoryReserves{0};     // 成功预留的座位
+    std::atomic<qint64> inventorySoldOut{0};      // 因余票为 0 被拒的预留
+    std::atomic<qint64> inventoryWriteBatches{0};
+    std::atomic<qint64> inventoryRowsWritten{0};  // 合并后写回的 UPDATE 行数
+    std::atomic<qint64> inventoryWriteFailures{0};
+    std::atomic<qint64> seatConflicts{0};         // 重建座位图时发现的重复座位
+
+    // 航班查询缓存
+    std::atomic<qint64> flightCacheHits{0};
+    std::atomic<qint64> flightCacheMisses{0};
+    std::atomic<qint64> flightCacheEntries{0};
+    std::atomic<qint64> flightCacheInvalidations{0};
+    std::atomic<qint64> flightCacheChecks{0};       // 航班目录校验次数
+    std::atomic<qint64> flightCacheLastCheckMs{0};  // 最近一次校验的时间戳（毫秒）
+
+    // 用户已预订航班索引
+    std::atomic<qint64> bookedIndexUsers{0};
+    std::atomic<qint64> bookedIndexHits{0};
+    std::atomic<qint64> bookedIndexLoads{0};        // 未缓存而从 orders 载入
+
+    // 流式回复
+    std::atomic<qint64> streamsStarted{0};
+    std::atomic<qint64> streamChunks{0};            // 已推送的分块帧数
+    std::atomic<qint64> streamsAborted{0};          // 连接关闭或客户端长时间不读而中止
+
+    std::atomic<qint64> subscriptionsActive{0}; // 所有连接订阅的航线总数
+    std::atomic<qint64> flightUpdatesPushed{0}; // 已推送的 flight_update 帧数
+
+    // 启动时写入的准入上限，随统计一起输出，供负载均衡判断余量
+    void setLimits(qint64 maxConnections, qint64 maxInFlightRequests);
+    void setDbPoolLimits(qint64 minSize, qint64 maxSize);
+    void setFlightCacheLimits(qint64 maxEntries, qint64 checkIntervalMs);
+    // 启动预热的结果，开始监听前写入一次
+    void setWarmUp(qint64 elapsedMs, qint64 connections, qint64 queries);
+
+    QJsonObject toJson() const;
+
+private:
+    ServerStats() = default;
+
+    qint64 m_maxConnections = 0;
+    qint64 m_maxInFlightRequests = 0;
+    qint64 m_dbPoolMin = 0;
+    qint64 m_dbPoolMax = 0;
+    qint64 m_flightCacheMax = 0;
+    qint64 m_flightCacheCheckMs = 0;
+    qint64 m_warmUpMs = 0;
+    qint64 m_warmUpConnections = 0;
+    qint64 m_warmUpQueries = 0;
+};
+
+#endif // SERVERSTATS_H
@@ -0,0 +1,157 @@
+#include "SqlStatements.h"
+
+QString SqlStatements::text(Id id)
+{
+    switch (id) {
+    case UserByPhone:
+        return "SELECT username, realname, phone, email, ID_card_number, password FROM userdata "
+               "WHERE phone = :phone";
+    case UserByUsername:
+        return "SELECT username, realname, phone, email, ID_card_number FROM userdata WHERE username = :username";
+    case UserPasswordByUsername:
+        return "SELECT password FROM userdata WHERE username = :username";
+    case UpdateUserPassword:
+        return "UPDATE userdata SET password = :newPwd WHERE username = :username";
+    case CountUserByUsername:
+        return "SELECT COUNT(*) FROM userdata WHERE username = :username";
+    case CountUserByPhone:
+        return "SELECT COUNT(*) FROM userdata WHERE phone = :phone";
+    case CountUserByIdCard:
+        return "SELECT COUNT(*) FROM userdata WHERE ID_card_number = :idCard";
+    case InsertUser:
+        return "INSERT INTO userdata (username, password, phone, ID_card_number, realname) "
+               "VALUES (:username, :password, :phone, :idCard, :realname)";
+
+    case FlightForBooking:
+        return "SELECT id, flight_num, from_city, to_city, date, price, remaining FROM flightdata "
+               "WHERE flight_num = :flight_num";
+    case FlightForRefund:
+        return "SELECT id, flight_num, from_city, to_city, date, price, remaining FROM flightdata "
+               "WHERE id = :flight_id";
+    case InsertOrder:
+        return "INSERT INTO orders (order_num, username, flight_id, passenger, seat, price, status, create_time) "
+               "VALUES (:order_num, :username, :flight_id, :passenger, :seat, :price, '待出行', NOW())";
+    case AdjustRemaining:
+        return "UPDATE flightdata SET remaining = remaining + :delta WHERE id = :flight_id";
+    case LoadInventory:
+        return "SELECT id, flight_num, from_city, to_city, date, price, remaining FROM flightdata";
+    case ActiveSeats:
+        return "SELECT flight_id, seat FROM orders WHERE status <> '已退票'";
+    case ActiveSeatsByFlight:
+        return "SELECT flight_id, seat FROM orders WHERE flight_id = :flight_id AND status <> '已退票'";
+    case OrderForRefund:
+        return R"(
+        SELECT o.flight_id, o.status, o.seat FROM orders o
+        WHERE o.order_num = :order_num AND o.username = :username
+    )";
+    case MarkOrderRefunded:
+        return "UPDATE orders SET status = '已退票' WHERE order_num = :order_num AND status <> '已退票'";
+    case BookedFlightsByUser:
+        return "SELECT order_num, flight_id FROM orders "
+               "WHERE username = :username AND (status = '待出行' OR status = '已完成')";
+    case FlightCatalogChecksum:
+        // 不含 remaining：余票以内存为准，由本服务写回，不应让缓存失效
+        return "SELECT COUNT(*), COALESCE(BIT_XOR(CRC32(CONCAT_WS('|', id, flight_num, airline, "
+               "from_city, to_city, from_airport, to_airport, date, depart_time, arrive_time, price))), 0) "
+               "FROM flightdata";
+
+    case CountPassengerByIdCard:
+        return "SELECT COUNT(*) FROM passengers WHERE ID_card_number = :idCard AND username = :username";
+    case InsertPassenger:
+        return "INSERT INTO passengers (username, real_name, ID_card_number, phone_number) "
+               "VALUES (:username, :realName, :idCard, :phone)";
+    case PassengersByUser:
+        return "SELECT id, real_name, ID_card_number, phone_number FROM passengers WHERE username = :username";
+    case CountPassengerOwned:
+        return "SELECT COUNT(*) FROM passengers WHERE id = :id AND username = :username";
+    case CountPassengerIdCardConflict:
+        return "SELECT COUNT(*) FROM passengers WHERE ID_card_number = :idCard AND username = :username AND id != :id";
+    case UpdatePassenger:
+        return "UPDATE passengers SET real_name = :realName, ID_card_number = :idCard, phone_number = :phone WHERE id = :id";
+    case DeletePassenger:
+        return "DELETE FROM passengers WHERE id = :id";
+
+    case Count:
+        break;
+
+    default:
+        if (id >= FlightList && id <= FlightListLast) {
+            // 只查与用户无关的航班行，结果可以被所有用户共用；是否已预订由 BookedFlightIndex 合并
+            const int filter = id - FlightList;
+            QString sql = R"(
+        SELECT f.id, f.flight_num, f.airline, f.from_city, f.to_city, f.from_airport, f.to_airport,
+               f.date, f.depart_time, f.arrive_time, f.price, f.remaining
+        FROM flightdata f
+        WHERE 1=1
+    )";
+            if (filter & FilterFromCity) sql += " AND f.from_city = :from";
+            if (filter & FilterToCity)   sql += " AND f.to_city = :to";
+            if (filter & FilterDate)     sql += " AND f.date = :date";
+            // 按 id 排序，分页游标记录上一页最后一行的 id
+            sql += " ORDER BY f.id";
+            return sql;
+        }
+        if (id >= OrderList && id <= OrderListLast) {
+            // 按 (create_time, order_num) 倒序做键集分页，游标为上一页最后一行的这两列
+            const int filter = id - OrderList;
+            QString sql = R"(
+        SELECT o.order_num, o.status, o.price, o.create_time,
+               f.flight_num, f.from_city, f.from_airport, f.to_city, f.to_airport,
+               f.date, f.depart_time, f.arrive_time
+        FROM orders o
+        LEFT JOIN flightdata f ON o.flight_id = f.id
+        WHERE o.username = :username
+    )";
+            if (filter & OrdersAfterCursor)
+                sql += " AND (o.create_time < :cursor_time"
+                       " OR (o.create_time = :cursor_time_eq AND o.order_num < :cursor_order))";
+            sql += " ORDER BY o.create_time DESC, o.order_num DESC";
+            if (filter & OrdersLimit)
+                sql += " LIMIT :limit";
+            return sql;
+        }
+        break;
+    }
+    return QString();
+}
+
+QString SqlStatements::name(Id id)
+{
+    switch (id) {
+    case UserByPhone:                   return "UserByPhone";
+    case UserByUsername:                return "UserByUsername";
+    case UserPasswordByUsername:        return "UserPasswordByUsername";
+    case UpdateUserPassword:            return "UpdateUserPassword";
+    case CountUserByUsername:           return "CountUserByUsername";
+    case CountUserByPhone:              return "CountUserByPhone";
+    case CountUserByIdCard:             return "CountUserByIdCard";
+    case InsertUser:                    return "InsertUser";
+    case FlightForBooking:              return "FlightForBooking";
+    case FlightForRefund:               return "FlightForRefund";
+    case InsertOrder:                   return "InsertOrder";
+    case AdjustRemaining:               return "AdjustRemaining";
+    case LoadInventory:                 return "LoadInventory";
+    case ActiveSeats:                   return "ActiveSeats";
+    case ActiveSeatsByFlight:           return "ActiveSeatsByFlight";
+    case OrderForRefund:                return "OrderForRefund";
+    case MarkOrderRefunded:             return "MarkOrderRefunded";
+    case BookedFlightsByUser:           return "BookedFlightsByUser";
+    case FlightCatalogChecksum:         return "FlightCatalogChecksum";
+    case CountPassengerByIdCard:        return "CountPassengerByIdCard";
+    case InsertPassenger:               return "InsertPassenger";
+    case PassengersByUser:              return "PassengersByUser";
+    case CountPassengerOwned:           return "CountPassengerOwned";
+    case CountPassengerIdCardConflict:  return "CountPassengerIdCardConflict";
+    case UpdatePassenger:               return "UpdatePassenger";
+    case DeletePassenger:               return "DeletePassenger";
+    case Count:
+        break;
+    default:
+        if (id >= FlightList && id <= FlightListLast)
+            return QString("FlightList+%1").arg(id - FlightList);
+        if (id >= OrderList && id <= OrderListLast)
+            return QString("OrderList+%1").arg(id - OrderList);
+        break;
+    }
+    return QString("Statement%1").arg(int(id));
+}
@@ -0,0 +1,100 @@
+#ifndef SQLSTATEMENTS_H
+#define SQLSTATEMENTS_H
+
+#include <QString>
+
+// 服务器执行的全部 SQL 语句。连接池中的每个连接按编号缓存预编译结果，
+// 同一语句在一个连接上只 prepare 一次，之后只需 bindValue 和 exec
+class SqlStatements
+{
+public:
+    enum Id {
+        // 用户
+        UserByPhone,
+        UserByUsername,
+        UserPasswordByUsername,
+        UpdateUserPassword,
+        CountUserByUsername,
+        CountUserByPhone,
+        CountUserByIdCard,
+        InsertUser,
+
+        // 航班与订单
+        FlightForBooking,
+        FlightForRefund,
+        InsertOrder,
+        AdjustRemaining,
+        LoadInventory,
+        ActiveSeats,
+        ActiveSeatsByFlight,
+        OrderForRefund,
+        MarkOrderRefunded,
+        BookedFlightsByUser,
+        FlightCatalogChecksum,
+
+        // 乘机人
+        CountPassengerByIdCard,
+        InsertPassenger,
+        PassengersByUser,
+        CountPassengerOwned,
+        CountPassengerIdCardConflict,
+        UpdatePassenger,
+        DeletePassenger,
+
+        // 航班列表：FlightList + 筛选条件掩码，共 8 个变体
+        FlightList,
+        FlightListLast = FlightList + 7,
+
+        // 订单列表：OrderList + 分页条件掩码，共 4 个变体
+        OrderList,
+        OrderListLast = OrderList + 3,
+
+        Count
+    };
+
+    // 航班列表的筛选条件，按位组合后加到 FlightList 上
+    enum FlightListFilter {
+        FilterFromCity = 1,
+        FilterToCity = 2,
+        FilterDate = 4
+    };
+
+    // 结果列的位置，与对应语句的 SELECT 列表一致；按位置取值，不必每行按列名查找
+    enum UserColumn {
+        UserName, UserRealName, UserPhone, UserEmail, UserIdCard,
+        UserPassword    // 只有 UserByPhone 取这一列
+    };
+    enum FlightColumn {
+        FlightId, FlightNum, FlightAirline, FlightFromCity, FlightToCity, FlightFromAirport,
+        FlightToAirport, FlightDate, FlightDepartTime, FlightArriveTime, FlightPrice, FlightRemaining
+    };
+    enum OrderColumn {
+        OrderNum, OrderStatus, OrderPrice, OrderCreateTime, OrderFlightNum, OrderFromCity,
+        OrderFromAirport, OrderToCity, OrderToAirport, OrderDate, OrderDepartTime, OrderArriveTime
+    };
+    enum RefundColumn { RefundFlightId, RefundStatus, RefundSeat };
+    enum PassengerColumn { PassengerId, PassengerRealName, PassengerIdCard, PassengerPhone };
+
+    static Id flightList(bool fromCity, bool toCity, bool date)
+    {
+        return Id(FlightList + (fromCity ? FilterFromCity : 0) + (toCity ? FilterToCity : 0)
+                  + (date ? FilterDate : 0));
+    }
+
+    // 订单列表的分页条件：从游标之后开始、限制行数
+    enum OrderListFilter {
+        OrdersAfterCursor = 1,
+        OrdersLimit = 2
+    };
+
+    static Id orderList(bool afterCursor, bool limit)
+    {
+        return Id(OrderList + (afterCursor ? OrdersAfterCursor : 0) + (limit ? OrdersLimit : 0));
+    }
+
+    static QString text(Id id);
+    // 日志与 EXPLAIN 报告中使用的语句名
+    static QString name(Id id);
+};
+
+#endif // SQLSTATEMENTS_H
@@ -0,0 +1,241 @@
+#include "SubscriptionHub.h"
+#include "ServerStats.h"
+#include <QJsonArray>
+#include <QMutexLocker>
+#include <QDebug>
+
+// 每个连接最多订阅的航线数
+static constexpr int kMaxRoutesPerSubscriber = 64;
+
+SubscriptionHub &SubscriptionHub::instance()
+{
+    static SubscriptionHub hub;
+    return hub;
+}
+
+QString SubscriptionHub::routeKey(const QString &fromCity, const QString &toCity, const QString &date)
+{
+    return fromCity + QLatin1Char('\x1f') + toCity + QLatin1Char('\x1f') + date;
+}
+
+void SubscriptionHub::publish(const QString &flightNum, const QString &fromCity, const QString &toCity,
+                              const QString &date, const std::atomic<int> &remaining)
+{
+    FlightUpdate update;
+    update.flightNum = flightNum;
+    update.routeKey = routeKey(fromCity, toCity, date);
+    update.remaining = &remaining;
+
+    // 持锁投递，保证订阅表在投递期间不会被释放；enqueue 只做合并和唤醒
+    QMutexLocker locker(&m_mutex);
+    auto it = m_interest.constFind(update.routeKey);
+    if (it == m_interest.constEnd())
+        return;
+    for (FlightSubscriptions *subscriptions : it.value())
+        subscriptions->enqueue(update);
+}
+
+void SubscriptionHub::addInterest(const QString &routeKey, FlightSubscriptions *subscriptions)
+{
+    QMutexLocker locker(&m_mutex);
+    m_interest[routeKey].insert(subscriptions);
+    m_routeCount.store(int(m_interest.size()), std::memory_order_relaxed);
+}
+
+void SubscriptionHub::removeInterest(const QString &routeKey, FlightSubscriptions *subscriptions)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_interest.find(routeKey);
+    if (it == m_interest.end())
+        return;
+    it.value().remove(subscriptions);
+    if (it.value().isEmpty())
+        m_interest.erase(it);
+    m_routeCount.store(int(m_interest.size()), std::memory_order_relaxed);
+}
+
+void SubscriptionHub::removeAll(FlightSubscriptions *subscriptions)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_interest.begin(); it != m_interest.end();) {
+        it.value().remove(subscriptions);
+        if (it.value().isEmpty())
+            it = m_interest.erase(it);
+        else
+            ++it;
+    }
+    m_routeCount.store(int(m_interest.size()), std::memory_order_relaxed);
+}
+
+FlightSubscriptions::FlightSubscriptions(Schedule schedule)
+    : m_schedule(std::move(schedule)) {}
+
+FlightSubscriptions::~FlightSubscriptions()
+{
+    SubscriptionHub::instance().removeAll(this);
+    qint64 count = 0;
+    for (const Subscriber &subscriber : std::as_const(m_subscribers))
+        count += subscriber.routes.size();
+    ServerStats::instance().subscriptionsActive.fetch_sub(count, std::memory_order_relaxed);
+}
+
+quint64 FlightSubscriptions::addSubscriber(Deliver deliver)
+{
+    const quint64 id = m_nextId++;
+    m_subscribers.insert(id, Subscriber{std::move(deliver), {}});
+    return id;
+}
+
+void FlightSubscriptions::removeSubscriber(quint64 subscriberId)
+{
+    unsubscribeAll(subscriberId);
+    m_subscribers.remove(subscriberId);
+}
+
+bool FlightSubscriptions::handleRequest(quint64 subscriberId, const QJsonObject &request, QJsonObject &reply)
+{
+    const QString type = request["type"].toString();
+    const bool isSubscribe = (type == "subscribe_flights");
+    if (!isSubscribe && type != "unsubscribe_flights")
+        return false;
+
+    QJsonObject data = request["data"].isObject() ? request["data"].toObject() : request;
+    const QString from = data["from_city"].toString();
+    const QString to = data["to_city"].toString();
+    const QString date = data["date"].toString();
+
+    reply = QJsonObject();
+    reply["type"] = type + "_reply";
+    if (request.contains("req_id"))
+        reply["req_id"] = request["req_id"];
+
+    auto it = m_subscribers.constFind(subscriberId);
+    if (it == m_subscribers.constEnd()) {
+        reply["success"] = false;
+        reply["message"] = "连接不支持订阅";
+        return true;
+    }
+
+    // 退订时三个字段都不填表示取消本连接的全部订阅
+    if (!isSubscribe && from.isEmpty() && to.isEmpty() && date.isEmpty()) {
+        unsubscribeAll(subscriberId);
+        reply["success"] = true;
+        reply["data"] = QJsonObject{{"routes", 0}};
+        return true;
+    }
+
+    for (const char *field : {"from_city", "to_city", "date"}) {
+        if (data[field].toString().isEmpty()) {
+            reply["success"] = false;
+            reply["message"] = QString("缺少字段：%1").arg(field);
+            return true;
+        }
+    }
+
+    const QString key = SubscriptionHub::routeKey(from, to, date);
+    if (isSubscribe) {
+        if (!it.value().routes.contains(key) && it.value().routes.size() >= kMaxRoutesPerSubscriber) {
+            reply["success"] = false;
+            reply["message"] = QString("订阅航线数超过上限 %1").arg(kMaxRoutesPerSubscriber);
+            return true;
+        }
+        subscribe(subscriberId, key);
+    } else {
+        unsubscribe(subscriberId, key);
+    }
+
+    reply["success"] = true;
+    reply["data"] = QJsonObject{{"routes", m_subscribers.value(subscriberId).routes.size()}};
+    return true;
+}
+
+void FlightSubscriptions::subscribe(quint64 subscriberId, const QString &routeKey)
+{
+    Subscriber &subscriber = m_subscribers[subscriberId];
+    if (subscriber.routes.contains(routeKey))
+        return;
+    subscriber.routes.insert(routeKey);
+
+    QSet<quint64> &ids = m_routes[routeKey];
+    if (ids.isEmpty())
+        SubscriptionHub::instance().addInterest(routeKey, this);
+    ids.insert(subscriberId);
+    ServerStats::instance().subscriptionsActive.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FlightSubscriptions::unsubscribe(quint64 subscriberId, const QString &routeKey)
+{
+    auto sub = m_subscribers.find(subscriberId);
+    if (sub == m_subscribers.end() || !sub.value().routes.remove(routeKey))
+        return;
+
+    auto it = m_routes.find(routeKey);
+    if (it != m_routes.end()) {
+        it.value().remove(subscriberId);
+        if (it.value().isEmpty()) {
+            m_routes.erase(it);
+            SubscriptionHub::instance().removeInterest(routeKey, this);
+        }
+    }
+    ServerStats::instance().subscriptionsActive.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void FlightSubscriptions::unsubscribeAll(quint64 subscriberId)
+{
+    const QSet<QString> routes = m_subscribers.value(subscriberId).routes;
+    for (const QString &routeKey : routes)
+        unsubscribe(subscriberId, routeKey);
+}
+
+void FlightSubscriptions::enqueue(const FlightUpdate &update)
+{
+    bool schedule = false;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        m_pending.insert(update.flightNum, update);
+        if (!m_drainScheduled) {
+            m_drainScheduled = true;
+            schedule = true;
+        }
+    }
+    if (schedule)
+        m_schedule();
+}
+
+void FlightSubscriptions::drain()
+{
+    QHash<QString, FlightUpdate> pending;
+    {
+        QMutexLocker locker(&m_pendingMutex);
+        m_drainScheduled = false;
+        if (m_pending.isEmpty())
+            return;
+        pending.swap(m_pending);
+    }
+
+    // 先按连接归并本轮所有变化，再逐个连接推送一帧
+    QHash<quint64, QJsonArray> batches;
+    for (const FlightUpdate &update : std::as_const(pending)) {
+        auto it = m_routes.constFind(update.routeKey);
+        if (it == m_routes.constEnd())
+            continue;   // 发布后已退订
+        const int remaining = update.remaining->load(std::memory_order_acquire);
+        const QJsonObject item{
+            {"flight_number", update.flightNum},
+            {"remaining", remaining},
+            {"status", remaining > 0 ? "有票" : "售罄"}
+        };
+        for (quint64 id : it.value())
+            batches[id].append(item);
+    }
+
+    for (auto it = batches.constBegin(); it != batches.constEnd(); ++it) {
+        // 推送可能因反压关闭连接并退订，每次都重新查找
+        auto sub = m_subscribers.constFind(it.key());
+        if (sub == m_subscribers.constEnd())
+            continue;
+        const Deliver deliver = sub.value().deliver;
+        deliver(QJsonObject{{"type", "flight_update"}, {"data", it.value()}});
+        ServerStats::instance().flightUpdatesPushed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
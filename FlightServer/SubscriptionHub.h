@@ -0,0 +1,99 @@
+#ifndef SUBSCRIPTIONHUB_H
+#define SUBSCRIPTIONHUB_H
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QJsonObject>
+#include <functional>
+#include <atomic>
+
+// 一个航班的余票变化。余票不在发布时取值，而是指向余票表中的实时计数，由 drain 推送前读取：
+// 并发订退票的发布顺序可能与计数变化顺序相反，推送的仍是最新值。
+// 余票表的航班在 I/O 线程全部停止后才释放，指针在 drain 期间一直有效
+struct FlightUpdate
+{
+    QString flightNum;
+    QString routeKey;
+    const std::atomic<int> *remaining = nullptr;
+};
+
+class FlightSubscriptions;
+
+// 进程级订阅中心：记录每条航线（出发地+目的地+日期）有哪些 I/O 线程关心，
+// 订票、退票改动余票后在这里发布，只投递给有订阅的线程
+class SubscriptionHub
+{
+public:
+    static SubscriptionHub &instance();
+
+    static QString routeKey(const QString &fromCity, const QString &toCity, const QString &date);
+
+    // 线程安全：当前是否有任何连接订阅
+    bool hasSubscribers() const { return m_routeCount.load(std::memory_order_relaxed) > 0; }
+
+    // 线程安全：发布余票变化，没有订阅时只做一次哈希查找；remaining 须比订阅连接活得久
+    void publish(const QString &flightNum, const QString &fromCity, const QString &toCity,
+                 const QString &date, const std::atomic<int> &remaining);
+
+private:
+    friend class FlightSubscriptions;
+
+    SubscriptionHub() = default;
+
+    void addInterest(const QString &routeKey, FlightSubscriptions *subscriptions);
+    void removeInterest(const QString &routeKey, FlightSubscriptions *subscriptions);
+    void removeAll(FlightSubscriptions *subscriptions);
+
+    QMutex m_mutex;
+    QHash<QString, QSet<FlightSubscriptions *>> m_interest;
+    std::atomic<int> m_routeCount{0};
+};
+
+// 一个 I/O 线程上的订阅表：同一轮收到的变化按航班合并，由本线程一次性分发给各订阅连接
+class FlightSubscriptions
+{
+public:
+    // 向一个连接推送一帧 flight_update
+    using Deliver = std::function<void(const QJsonObject &frame)>;
+    // 在任意线程调用，须安排所属线程在下一轮事件循环中调用 drain()
+    using Schedule = std::function<void()>;
+
+    explicit FlightSubscriptions(Schedule schedule);
+    ~FlightSubscriptions();
+
+    // 以下在所属线程调用
+    quint64 addSubscriber(Deliver deliver);
+    void removeSubscriber(quint64 subscriberId);
+
+    // 处理 subscribe_flights / unsubscribe_flights，其他类型返回 false
+    bool handleRequest(quint64 subscriberId, const QJsonObject &request, QJsonObject &reply);
+
+    // 把本轮积累的变化推送给订阅了对应航线的连接，每个连接一帧
+    void drain();
+
+    // 任意线程：由 SubscriptionHub 持锁调用
+    void enqueue(const FlightUpdate &update);
+
+private:
+    struct Subscriber {
+        Deliver deliver;
+        QSet<QString> routes;
+    };
+
+    void subscribe(quint64 subscriberId, const QString &routeKey);
+    void unsubscribe(quint64 subscriberId, const QString &routeKey);
+    void unsubscribeAll(quint64 subscriberId);
+
+    Schedule m_schedule;
+    QHash<quint64, Subscriber> m_subscribers;
+    QHash<QString, QSet<quint64>> m_routes;
+    quint64 m_nextId = 1;
+
+    QMutex m_pendingMutex;
+    QHash<QString, FlightUpdate> m_pending;     // 按航班号合并，一轮只推送一次
+    bool m_drainScheduled = false;
+};
+
+#endif // SUBSCRIPTIONHUB_H
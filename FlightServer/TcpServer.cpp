@@ -1,48 +1,199 @@
 #include "TcpServer.h"
-#include "ClientHandler.h"
+#include "WorkerPool.h"
+#include "RequestDispatcher.h"
+#include "Acceptor.h"
+#include "ServerStats.h"
+#include "SchemaMigrator.h"
 #include <QDebug>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QElapsedTimer>
 
-TcpServer::TcpServer(QObject *parent) : QTcpServer(parent)
+TcpServer::TcpServer(const ServerConfig &config, QObject *parent)
+    : QObject(parent), m_config(config)
 {
     m_dbHandler = new DbHandler(this);
+    m_dbHandler->setWorkerThreadCount(m_config.dbThreads);
+
+    // 每个数据库线程同时最多用一个连接，再留一个给余票写线程；主线程的启动查询用完即迁出，不单独占名额
+    DbConnectionPool::Options poolOptions;
+    poolOptions.minSize = m_config.dbPoolMin;
+    poolOptions.maxSize = m_config.dbPoolMax > 0 ? m_config.dbPoolMax
+                                                 : qMax(1, m_config.dbThreads) + 1;
+    poolOptions.checkoutTimeoutMs = m_config.dbCheckoutTimeoutMs;
+    poolOptions.idleTimeoutMs = m_config.dbIdleTimeoutMs;
+    m_dbHandler->setPoolOptions(poolOptions);
+    m_dbHandler->setFlightCacheOptions(m_config.flightCacheEntries, m_config.flightCacheCheckMs);
     if (!m_dbHandler->connectDb("flightSystem", "root", "jrr582200")) {
         qFatal("数据库连接失败");
     }
+
+    // 索引只影响性能，迁移失败时报告后照常启动
+    if (m_config.schemaCheck != ServerConfig::SchemaCheck::Off) {
+        DbConnectionPool::Lease lease = m_dbHandler->acquireStartupConnection();
+        SchemaMigrator(lease).run(m_config.schemaCheck == ServerConfig::SchemaCheck::Migrate);
+    }
+
+    m_dispatcher = new RequestDispatcher(m_dbHandler, m_config);
+    ServerStats::instance().setLimits(m_config.maxConnections, m_config.maxInFlightRequests);
+    m_workerPool = new WorkerPool(m_config, m_dispatcher, this);
+}
+
+TcpServer::~TcpServer()
+{
+    // 先停止接受新连接，再停工作线程，保证连接在 DbHandler 释放前关闭
+    stopAcceptors();
+    m_workerPool->stop();
+    delete m_dispatcher;
 }
 
 bool TcpServer::startServer(quint16 port)
 {
-    if (listen(QHostAddress::Any, port)) {
-        qInfo() << "服务器启动成功，端口：" << port;
+    // 预热完成后才监听，部署后的第一批请求不再承担建连、预编译和冷缓存的开销
+    warmUp();
+
+    m_workerPool->start();
+
+    if (startAcceptors(port)) {
+        qInfo() << "服务器就绪，端口：" << port << "接收线程数：" << m_acceptors.size();
         return true;
     } else {
-        qCritical() << "服务器启动失败：" << errorString();
+        qCritical() << "服务器启动失败";
+        stopAcceptors();
         return false;
     }
 }
 
-void TcpServer::incomingConnection(qintptr socketDescriptor)
+void TcpServer::warmUp()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 库名和表名只在启动时查询一次，不再放在每次接受连接的路径上；余票与座位图已在 connectDb 中整表载入
+    qInfo() << "当前数据库名：" << getDatabaseName();
+    qInfo() << "当前数据库表：" << getTableNames();
+
+    const int connections = m_dbHandler->warmUpConnections(
+        m_config.warmupConnections > 0 ? m_config.warmupConnections : m_config.dbPoolMin);
+    qInfo() << "已预热数据库连接：" << connections;
+
+    int queries = 0;
+    if (!m_config.warmupQueriesFile.isEmpty())
+        queries = replayWarmUpQueries(m_config.warmupQueriesFile);
+
+    const qint64 elapsed = timer.elapsed();
+    ServerStats::instance().setWarmUp(elapsed, connections, queries);
+    qInfo() << "预热完成，用时" << elapsed << "毫秒";
+}
+
+int TcpServer::replayWarmUpQueries(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法打开预热请求文件：" << path << file.errorString();
+        return 0;
+    }
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isArray()) {
+        qWarning() << "预热请求文件应为请求对象的 JSON 数组：" << path;
+        return 0;
+    }
+
+    // 在数据库线程池中并发执行，与真实请求走同一条路径；会修改数据的请求不回放
+    QList<QFuture<Reply>> replies;
+    const QJsonArray requests = doc.array();
+    for (const QJsonValue &value : requests) {
+        const QJsonObject request = value.toObject();
+        const HandlerDescriptor *handler = m_dispatcher->findHandler(request["type"].toString());
+        if (!handler || !handler->readOnly) {
+            qWarning() << "跳过预热请求：" << request["type"].toString();
+            continue;
+        }
+        if (!m_dispatcher->tryBeginRequest())
+            break;
+        replies.append(m_dispatcher->dispatchAsync(request));
+    }
+
+    int failures = 0;
+    for (QFuture<Reply> &reply : replies) {
+        if (!reply.result().json["success"].toBool())
+            ++failures;
+    }
+    qInfo() << "已回放预热请求：" << replies.size() << "失败：" << failures;
+    return int(replies.size());
+}
+
+int TcpServer::explainStatements()
 {
-    qInfo() << "新客户端连接：" << socketDescriptor;
+    DbConnectionPool::Lease lease = m_dbHandler->acquireStartupConnection();
+    return SchemaMigrator(lease).explainStatements();
+}
 
-    // 获取数据库名和表名
-    QString dbName = getDatabaseName();
-    QStringList tables = getTableNames();
+bool TcpServer::startAcceptors(quint16 port)
+{
+    int count = m_config.acceptorThreads;
+    if (count > 1 && !Acceptor::reusePortSupported()) {
+        qWarning() << "当前平台不支持 SO_REUSEPORT，使用单个接收线程";
+        count = 1;
+    }
 
-    qInfo() << "当前数据库名：" << dbName;
-    qInfo() << "当前数据库表：" << tables;
+    // 单个接收者直接在主线程监听，行为与以前一致
+    if (count <= 1) {
+        Acceptor *acceptor = new Acceptor(0, m_config, m_workerPool);
+        m_acceptors.append(acceptor);
+        return acceptor->listenOn(port, false);
+    }
+
+    // 多个接收者各自持有一个 SO_REUSEPORT 监听套接字，运行在独立线程中
+    for (int i = 0; i < count; ++i) {
+        QThread *thread = new QThread();
+        thread->setObjectName(QString("acceptor_%1").arg(i));
+        Acceptor *acceptor = new Acceptor(i, m_config, m_workerPool);
+        acceptor->moveToThread(thread);
+        m_acceptorThreads.append(thread);
+        m_acceptors.append(acceptor);
+        thread->start();
+
+        bool ok = false;
+        QMetaObject::invokeMethod(acceptor, [acceptor, port, &ok]() {
+            ok = acceptor->listenOn(port, true);
+        }, Qt::BlockingQueuedConnection);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
 
-    // 创建客户端处理器
-    ClientHandler *handler = new ClientHandler(socketDescriptor, m_dbHandler, this);
-    connect(handler, &ClientHandler::finished, handler, &ClientHandler::deleteLater);
-    handler->start();
+void TcpServer::stopAcceptors()
+{
+    if (m_acceptorThreads.isEmpty()) {
+        qDeleteAll(m_acceptors);
+        m_acceptors.clear();
+        return;
+    }
+
+    for (int i = 0; i < m_acceptorThreads.size(); ++i) {
+        QThread *thread = m_acceptorThreads[i];
+        Acceptor *acceptor = m_acceptors[i];
+        // 监听套接字与拒绝中的连接都属于接收线程，在该线程内释放
+        QMetaObject::invokeMethod(acceptor, [acceptor]() {
+            delete acceptor;
+        }, Qt::BlockingQueuedConnection);
+        thread->quit();
+        thread->wait();
+    }
+    m_acceptors.clear();
+    qDeleteAll(m_acceptorThreads);
+    m_acceptorThreads.clear();
 }
 
 QString TcpServer::getDatabaseName()
 {
-    QSqlQuery query(m_dbHandler->getDb());
+    DbConnectionPool::Lease lease = m_dbHandler->acquireStartupConnection();
+    QSqlQuery query(lease.database());
     if (query.exec("SELECT DATABASE();")) {
         if (query.next()) {
             return query.value(0).toString();
@@ -55,7 +206,8 @@ QString TcpServer::getDatabaseName()
 QStringList TcpServer::getTableNames()
 {
     QStringList tables;
-    QSqlQuery query(m_dbHandler->getDb());
+    DbConnectionPool::Lease lease = m_dbHandler->acquireStartupConnection();
+    QSqlQuery query(lease.database());
     if (query.exec("SHOW TABLES;")) {
         while (query.next()) {
             tables << query.value(0).toString();
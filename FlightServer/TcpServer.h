@@ -1,21 +1,40 @@
 #ifndef TCPSERVER_H
 #define TCPSERVER_H
 
-#include <QTcpServer>
+#include <QObject>
+#include <QList>
+#include <QThread>
 #include "DbHandler.h"
+#include "ServerConfig.h"
 
-class TcpServer : public QTcpServer
+class WorkerPool;
+class RequestDispatcher;
+class Acceptor;
+
+class TcpServer : public QObject
 {
     Q_OBJECT
 public:
-    explicit TcpServer(QObject *parent = nullptr);
+    explicit TcpServer(const ServerConfig &config, QObject *parent = nullptr);
+    ~TcpServer();
     bool startServer(quint16 port);
 
-protected:
-    void incomingConnection(qintptr socketDescriptor) override;
+    // EXPLAIN 全部语句，返回意外全表扫描的语句数
+    int explainStatements();
 
 private:
+    // 监听前的预热：预编译各数据库线程的语句，可选回放只读请求
+    void warmUp();
+    int replayWarmUpQueries(const QString &path);
+    bool startAcceptors(quint16 port);
+    void stopAcceptors();
+
+    ServerConfig m_config;
     DbHandler *m_dbHandler;
+    RequestDispatcher *m_dispatcher;
+    WorkerPool *m_workerPool;
+    QList<Acceptor *> m_acceptors;
+    QList<QThread *> m_acceptorThreads;
     QString getDatabaseName();
     QStringList getTableNames();
 
@@ -0,0 +1,82 @@
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(int tickMs) : m_tickMs(tickMs > 0 ? tickMs : 1)
+{
+    m_clock.start();
+}
+
+TimerWheel::TimerId TimerWheel::schedule(qint64 delayMs, Callback callback)
+{
+    // 最高层能表示的最大跨度，超出的定时器提前到期，由调用方自行重新判断
+    static constexpr quint64 kMaxTicks = (quint64(1) << (kSlotBits * kLevels)) - 1;
+
+    // 向上取整到刻度，保证不会早于 delayMs 触发
+    const quint64 dueMs = quint64(now() + qMax<qint64>(delayMs, 0));
+    quint64 expireTick = (dueMs + quint64(m_tickMs) - 1) / quint64(m_tickMs);
+    if (expireTick <= m_currentTick)
+        expireTick = m_currentTick + 1;
+    if (expireTick - m_currentTick > kMaxTicks)
+        expireTick = m_currentTick + kMaxTicks;
+
+    const TimerId id = m_nextId++;
+    m_callbacks.insert(id, std::move(callback));
+    insert({id, expireTick});
+    return id;
+}
+
+void TimerWheel::cancel(TimerId id)
+{
+    // 槽中的条目在轮到时因找不到回调而被丢弃
+    m_callbacks.remove(id);
+}
+
+void TimerWheel::advance(qint64 nowMs)
+{
+    const quint64 target = quint64(nowMs) / quint64(m_tickMs);
+    while (m_currentTick < target)
+        tick();
+}
+
+void TimerWheel::insert(const Entry &entry)
+{
+    const quint64 delta = entry.expireTick - m_currentTick;
+    for (int level = 0; level < kLevels; ++level) {
+        const int shift = kSlotBits * (level + 1);
+        if (delta < (quint64(1) << shift) || level == kLevels - 1) {
+            const int slot = int((entry.expireTick >> (kSlotBits * level)) & (kSlots - 1));
+            m_slots[level][slot].append(entry);
+            return;
+        }
+    }
+}
+
+void TimerWheel::tick()
+{
+    ++m_currentTick;
+
+    // 低层转满一圈时，把上一层当前槽中的定时器下放到更精细的层
+    for (int level = 1; level < kLevels; ++level) {
+        const quint64 lowMask = (quint64(1) << (kSlotBits * level)) - 1;
+        if (m_currentTick & lowMask)
+            break;
+        const int slot = int((m_currentTick >> (kSlotBits * level)) & (kSlots - 1));
+        QList<Entry> entries;
+        entries.swap(m_slots[level][slot]);
+        for (const Entry &entry : std::as_const(entries)) {
+            if (m_callbacks.contains(entry.id))
+                insert(entry);
+        }
+    }
+
+    QList<Entry> due;
+    due.swap(m_slots[0][m_currentTick & (kSlots - 1)]);
+    for (const Entry &entry : std::as_const(due)) {
+        auto it = m_callbacks.find(entry.id);
+        if (it == m_callbacks.end())
+            continue;
+        // 先移除再调用，回调中可以安全地重新调度或取消其它定时器
+        Callback callback = std::move(it.value());
+        m_callbacks.erase(it);
+        callback();
+    }
+}
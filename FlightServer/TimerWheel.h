@@ -0,0 +1,51 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+#include <functional>
+
+// 分层时间轮：每个 I/O 工作线程一个，由单个 QTimer 驱动，
+// 管理该线程上所有连接的心跳、空闲和半包超时，避免每个套接字一个 QTimer
+class TimerWheel
+{
+public:
+    using TimerId = quint64;
+    using Callback = std::function<void()>;
+
+    explicit TimerWheel(int tickMs);
+
+    // delayMs 毫秒后在本线程触发回调，精度为一个刻度
+    TimerId schedule(qint64 delayMs, Callback callback);
+    void cancel(TimerId id);
+
+    // 推进到 nowMs，依次触发所有到期的定时器
+    void advance(qint64 nowMs);
+
+    qint64 now() const { return m_clock.elapsed(); }
+    int tickMs() const { return m_tickMs; }
+    int pendingCount() const { return int(m_callbacks.size()); }
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 6;
+    static constexpr int kSlots = 1 << kSlotBits;
+
+    struct Entry {
+        TimerId id;
+        quint64 expireTick;
+    };
+
+    void insert(const Entry &entry);
+    void tick();
+
+    QList<Entry> m_slots[kLevels][kSlots];
+    QHash<TimerId, Callback> m_callbacks;
+    quint64 m_currentTick = 0;
+    TimerId m_nextId = 1;
+    int m_tickMs;
+    QElapsedTimer m_clock;
+};
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,242 @@
+#include "WireEncoder.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QLocale>
+#include <QtEndian>
+#include <cmath>
+
+WireEncoder::WireEncoder(QByteArray &out, NetworkUtils::WireFormat format)
+    : m_out(out), m_format(format), m_headerPos(out.size())
+{
+    m_out.append(2 * sizeof(quint32), '\0');
+    if (m_format == NetworkUtils::Cbor)
+        m_cbor = std::make_unique<QCborStreamWriter>(&m_out);
+}
+
+WireEncoder::~WireEncoder()
+{
+    finish();
+}
+
+void WireEncoder::finish()
+{
+    if (m_finished)
+        return;
+    m_finished = true;
+    m_cbor.reset();
+
+    // 帧头原位回填，长度不变，不影响已写出的载荷
+    const quint32 payloadSize = quint32(m_out.size() - m_headerPos - 2 * sizeof(quint32));
+    char *header = m_out.data() + m_headerPos;
+    qToBigEndian<quint32>(payloadSize + sizeof(quint32), header);
+    qToBigEndian<quint32>(payloadSize, header + sizeof(quint32));
+}
+
+void WireEncoder::separator()
+{
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+    if (m_first.isEmpty())
+        return;
+    if (!m_first.last())
+        m_out.append(',');
+    m_first.last() = false;
+}
+
+void WireEncoder::beginMap(qsizetype size)
+{
+    if (m_cbor) {
+        m_cbor->startMap(quint64(size));
+        return;
+    }
+    separator();
+    m_out.append('{');
+    m_first.append(true);
+}
+
+void WireEncoder::endMap()
+{
+    if (m_cbor) {
+        m_cbor->endMap();
+        return;
+    }
+    m_first.removeLast();
+    m_out.append('}');
+}
+
+void WireEncoder::beginArray(qsizetype size)
+{
+    if (m_cbor) {
+        m_cbor->startArray(quint64(size));
+        return;
+    }
+    separator();
+    m_out.append('[');
+    m_first.append(true);
+}
+
+void WireEncoder::endArray()
+{
+    if (m_cbor) {
+        m_cbor->endArray();
+        return;
+    }
+    m_first.removeLast();
+    m_out.append(']');
+}
+
+void WireEncoder::key(QLatin1String name)
+{
+    if (m_cbor) {
+        m_cbor->append(name);
+        return;
+    }
+    separator();
+    // 字段名都是代码中的 ASCII 常量，不需要转义
+    m_out.append('"');
+    m_out.append(name.data(), name.size());
+    m_out.append("\":", 2);
+    m_afterKey = true;
+}
+
+void WireEncoder::key(const QString &name)
+{
+    if (m_cbor) {
+        m_cbor->append(name);
+        return;
+    }
+    separator();
+    appendJsonString(name);
+    m_out.append(':');
+    m_afterKey = true;
+}
+
+void WireEncoder::value(const QString &text)
+{
+    if (m_cbor) {
+        m_cbor->append(text);
+        return;
+    }
+    separator();
+    appendJsonString(text);
+}
+
+void WireEncoder::value(qint64 number)
+{
+    if (m_cbor) {
+        m_cbor->append(number);
+        return;
+    }
+    separator();
+    m_out.append(QByteArray::number(number));
+}
+
+void WireEncoder::value(bool flag)
+{
+    if (m_cbor) {
+        m_cbor->append(flag);
+        return;
+    }
+    separator();
+    m_out.append(flag ? "true" : "false");
+}
+
+void WireEncoder::value(const QJsonValue &json)
+{
+    if (m_cbor) {
+        NetworkUtils::writeCbor(*m_cbor, json);
+        return;
+    }
+    separator();
+    appendJsonValue(json);
+}
+
+void WireEncoder::appendJsonValue(const QJsonValue &json)
+{
+    switch (json.type()) {
+    case QJsonValue::Null:
+    case QJsonValue::Undefined:
+        m_out.append("null");
+        break;
+    case QJsonValue::Bool:
+        m_out.append(json.toBool() ? "true" : "false");
+        break;
+    case QJsonValue::Double: {
+        // 与 QJsonDocument 一致：整数值不带小数点，非有限值写 null
+        const double d = json.toDouble();
+        const qint64 i = json.toInteger();
+        if (!std::isfinite(d))
+            m_out.append("null");
+        else if (double(i) == d)
+            m_out.append(QByteArray::number(i));
+        else
+            m_out.append(QByteArray::number(d, 'g', QLocale::FloatingPointShortest));
+        break;
+    }
+    case QJsonValue::String:
+        appendJsonString(json.toString());
+        break;
+    case QJsonValue::Array:
+        // 信封中的嵌套值很小，交给 QJsonDocument
+        m_out.append(QJsonDocument(json.toArray()).toJson(QJsonDocument::Compact));
+        break;
+    case QJsonValue::Object:
+        m_out.append(QJsonDocument(json.toObject()).toJson(QJsonDocument::Compact));
+        break;
+    }
+}
+
+void WireEncoder::appendJsonString(QStringView text)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    m_out.append('"');
+    const qsizetype size = text.size();
+    for (qsizetype i = 0; i < size; ++i) {
+        const char16_t c = text[i].unicode();
+        if (c < 0x80) {
+            switch (c) {
+            case '"':  m_out.append("\\\"", 2); break;
+            case '\\': m_out.append("\\\\", 2); break;
+            case '\b': m_out.append("\\b", 2); break;
+            case '\f': m_out.append("\\f", 2); break;
+            case '\n': m_out.append("\\n", 2); break;
+            case '\r': m_out.append("\\r", 2); break;
+            case '\t': m_out.append("\\t", 2); break;
+            default:
+                if (c < 0x20) {
+                    const char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                    m_out.append(escaped, sizeof(escaped));
+                } else {
+                    m_out.append(char(c));
+                }
+            }
+            continue;
+        }
+
+        // 直接编码为 UTF-8，不经过 toUtf8 的临时缓冲
+        char32_t code = c;
+        if (QChar::isHighSurrogate(c) && i + 1 < size && QChar::isLowSurrogate(text[i + 1].unicode())) {
+            code = QChar::surrogateToUcs4(c, text[++i].unicode());
+        } else if (QChar::isSurrogate(c)) {
+            code = QChar::ReplacementCharacter;
+        }
+
+        if (code < 0x800) {
+            const char bytes[] = {char(0xc0 | (code >> 6)), char(0x80 | (code & 0x3f))};
+            m_out.append(bytes, 2);
+        } else if (code < 0x10000) {
+            const char bytes[] = {char(0xe0 | (code >> 12)), char(0x80 | ((code >> 6) & 0x3f)),
+                                  char(0x80 | (code & 0x3f))};
+            m_out.append(bytes, 3);
+        } else {
+            const char bytes[] = {char(0xf0 | (code >> 18)), char(0x80 | ((code >> 12) & 0x3f)),
+                                  char(0x80 | ((code >> 6) & 0x3f)), char(0x80 | (code & 0x3f))};
+            m_out.append(bytes, 4);
+        }
+    }
+    m_out.append('"');
+}
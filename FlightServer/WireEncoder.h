@@ -0,0 +1,63 @@
+#ifndef WIREENCODER_H
+#define WIREENCODER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QJsonValue>
+#include <QCborStreamWriter>
+#include <QVarLengthArray>
+#include <memory>
+#include "NetworkUtils.h"
+
+// 按连接编码直接向输出缓冲区写一帧，不构造 QJsonObject/QCborValue 树。
+// 构造时预留帧头，finish 时回填长度，帧格式与 NetworkUtils::appendFrame 相同。
+// 调用方负责结构正确：映射中 key 与 value 交替出现，begin/end 成对
+class WireEncoder
+{
+public:
+    WireEncoder(QByteArray &out, NetworkUtils::WireFormat format);
+    ~WireEncoder();
+
+    void beginMap(qsizetype size);
+    void endMap();
+    void beginArray(qsizetype size);
+    void endArray();
+
+    void key(QLatin1String name);
+    void key(const QString &name);
+
+    void value(const QString &text);
+    void value(qint64 number);
+    void value(int number) { value(qint64(number)); }
+    void value(bool flag);
+    // 信封中的任意 JSON 值，嵌套的对象与数组仍逐项写出
+    void value(const QJsonValue &json);
+
+    template <typename T>
+    void field(QLatin1String name, const T &v)
+    {
+        key(name);
+        value(v);
+    }
+
+    // 回填帧头，之后不能再写
+    void finish();
+
+private:
+    void separator();
+    void appendJsonString(QStringView text);
+    void appendJsonValue(const QJsonValue &json);
+
+    QByteArray &m_out;
+    NetworkUtils::WireFormat m_format;
+    qsizetype m_headerPos;
+    // CBOR 写出器在帧头之后创建：它内部的 QBuffer 从创建时的末尾开始追加
+    std::unique_ptr<QCborStreamWriter> m_cbor;
+
+    // JSON：每层容器是否还没有写过元素，决定是否需要逗号
+    QVarLengthArray<bool, 8> m_first;
+    bool m_afterKey = false;
+    bool m_finished = false;
+};
+
+#endif // WIREENCODER_H
@@ -0,0 +1,130 @@
+#include "WorkerPool.h"
+#include "IoWorker.h"
+#include "EpollReactor.h"
+#include <QDebug>
+
+WorkerPool::WorkerPool(const ServerConfig &config, RequestDispatcher *dispatcher, QObject *parent)
+    : QObject(parent)
+{
+    int threadCount = config.ioThreads;
+    if (threadCount < 1)
+        threadCount = 1;
+
+    if (config.ioBackend == ServerConfig::IoBackend::Epoll) {
+#ifdef Q_OS_LINUX
+        for (int i = 0; i < threadCount; ++i) {
+            EpollReactor *reactor = new EpollReactor(i, config, dispatcher);
+            if (!reactor->init()) {
+                delete reactor;
+                qDeleteAll(m_reactors);
+                m_reactors.clear();
+                qWarning() << "epoll 反应器初始化失败，改用 Qt 套接字后端";
+                break;
+            }
+            m_reactors.append(reactor);
+        }
+        if (!m_reactors.isEmpty())
+            return;
+#else
+        qWarning() << "epoll 后端仅支持 Linux，改用 Qt 套接字后端";
+#endif
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+        QThread *thread = new QThread();
+        thread->setObjectName(QString("io_worker_%1").arg(i));
+
+        IoWorker *worker = new IoWorker(i, config, dispatcher);
+        worker->moveToThread(thread);
+
+        m_threads.append(thread);
+        m_workers.append(worker);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+void WorkerPool::start()
+{
+#ifdef Q_OS_LINUX
+    if (!m_reactors.isEmpty()) {
+        for (EpollReactor *reactor : std::as_const(m_reactors))
+            reactor->start();
+        qInfo() << "epoll 反应器线程数：" << m_reactors.size();
+        return;
+    }
+#endif
+    for (QThread *thread : std::as_const(m_threads))
+        thread->start();
+    qInfo() << "I/O 工作线程数：" << m_threads.size();
+}
+
+void WorkerPool::stop()
+{
+#ifdef Q_OS_LINUX
+    // 反应器在自己的线程中关闭全部连接后退出
+    for (EpollReactor *reactor : std::as_const(m_reactors)) {
+        reactor->requestStop();
+        reactor->wait();
+    }
+    qDeleteAll(m_reactors);
+    m_reactors.clear();
+#endif
+
+    for (int i = 0; i < m_threads.size(); ++i) {
+        QThread *thread = m_threads[i];
+        if (thread->isRunning()) {
+            // 连接和定时器属于工作线程，在该线程内释放
+            QMetaObject::invokeMethod(m_workers[i], &IoWorker::shutdown, Qt::BlockingQueuedConnection);
+        }
+        thread->quit();
+        thread->wait();
+    }
+    // 线程已退出，可直接在当前线程释放工作对象及其下的连接
+    qDeleteAll(m_workers);
+    m_workers.clear();
+    qDeleteAll(m_threads);
+    m_threads.clear();
+}
+
+bool WorkerPool::dispatch(qintptr socketDescriptor)
+{
+#ifdef Q_OS_LINUX
+    if (!m_reactors.isEmpty()) {
+        m_reactors[pickLeastLoaded(m_reactors)]->addConnection(socketDescriptor);
+        return true;
+    }
+#endif
+
+    const int index = pickLeastLoaded(m_workers);
+    if (index < 0) {
+        qWarning() << "没有可用的工作线程，丢弃连接：" << socketDescriptor;
+        return false;
+    }
+    IoWorker *worker = m_workers[index];
+    QMetaObject::invokeMethod(worker, [worker, socketDescriptor]() {
+        worker->addConnection(socketDescriptor);
+    }, Qt::QueuedConnection);
+    return true;
+}
+
+template <typename Worker>
+int WorkerPool::pickLeastLoaded(const QList<Worker *> &workers)
+{
+    if (workers.isEmpty())
+        return -1;
+
+    // 从轮询起点开始找连接数最少的线程，负载相同时自然退化为轮询
+    const int count = workers.size();
+    const int start = int(m_nextIndex.fetch_add(1, std::memory_order_relaxed) % count);
+    int best = start;
+    for (int i = 1; i < count; ++i) {
+        const int index = (start + i) % count;
+        if (workers[index]->connectionCount() < workers[best]->connectionCount())
+            best = index;
+    }
+    return best;
+}
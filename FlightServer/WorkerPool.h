@@ -0,0 +1,42 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QThread>
+#include <atomic>
+#include "RequestDispatcher.h"
+#include "ServerConfig.h"
+
+class IoWorker;
+class EpollReactor;
+
+// 固定数量的 I/O 工作线程池，新连接按最少连接数（相同时轮询）分配；
+// 线程可以是 Qt 事件循环（IoWorker），也可以是 Linux 下的 epoll 反应器（EpollReactor）
+class WorkerPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WorkerPool(const ServerConfig &config, RequestDispatcher *dispatcher, QObject *parent = nullptr);
+    ~WorkerPool();
+
+    void start();
+    void stop();
+
+    // 线程安全：可从任意接受连接的线程调用。没有可用线程时返回 false，描述符仍归调用方处理
+    bool dispatch(qintptr socketDescriptor);
+
+    int threadCount() const { return m_workers.size() + m_reactors.size(); }
+
+private:
+    // 返回连接数最少的线程下标，没有线程时返回 -1
+    template <typename Worker>
+    int pickLeastLoaded(const QList<Worker *> &workers);
+
+    QList<QThread *> m_threads;
+    QList<IoWorker *> m_workers;
+    QList<EpollReactor *> m_reactors;
+    std::atomic<unsigned int> m_nextIndex{0};
+};
+
+#endif // WORKERPOOL_H
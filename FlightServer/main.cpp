@@ -1,12 +1,217 @@
 #include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QJsonDocument>
 #include "TcpServer.h"
+#include "ServerConfig.h"
+#include "EncoderBench.h"
+#include "ConnectionBench.h"
+#include "LoadBench.h"
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
 
-    TcpServer server;
-    if (!server.startServer(8888)) {
+    ServerConfig config;
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption portOption("port", "监听端口", "port", QString::number(config.port));
+    QCommandLineOption acceptorsOption("acceptors", "接收连接的线程数，大于 1 时使用 SO_REUSEPORT",
+                                       "count", QString::number(config.acceptorThreads));
+    QCommandLineOption ioThreadsOption("io-threads", "I/O 工作线程数（默认为 CPU 核数）",
+                                       "count", QString::number(config.ioThreads));
+    QCommandLineOption backendOption("io-backend", "连接 I/O 后端：qt 或 epoll（仅 Linux）",
+                                     "backend", "qt");
+    QCommandLineOption dbThreadsOption("db-threads", "数据库工作线程数",
+                                       "count", QString::number(config.dbThreads));
+    QCommandLineOption dbPoolMinOption("db-pool-min", "数据库连接池常驻连接数",
+                                       "count", QString::number(config.dbPoolMin));
+    QCommandLineOption dbPoolMaxOption("db-pool-max", "数据库连接池上限（0 为数据库线程数 + 1）",
+                                       "count", QString::number(config.dbPoolMax));
+    QCommandLineOption dbCheckoutTimeoutOption("db-checkout-timeout", "等待数据库连接的最长毫秒数",
+                                               "ms", QString::number(config.dbCheckoutTimeoutMs));
+    QCommandLineOption schemaCheckOption("schema-check", "启动时的表结构检查：migrate、verify 或 off",
+                                         "mode", "migrate");
+    QCommandLineOption explainOption("explain-statements", "对全部语句执行 EXPLAIN，报告全表扫描后退出");
+    QCommandLineOption warmupConnectionsOption("warmup-connections",
+                                               "监听前预热的数据库连接数（0 为连接池常驻连接数）",
+                                               "count", QString::number(config.warmupConnections));
+    QCommandLineOption warmupQueriesOption("warmup-queries", "监听前回放的只读请求文件（JSON 数组）", "file");
+    QCommandLineOption flightCacheOption("flight-cache", "航班查询缓存的路线数上限（0 关闭）",
+                                         "count", QString::number(config.flightCacheEntries));
+    QCommandLineOption flightCacheCheckOption("flight-cache-check", "校验航班目录是否被外部改动的间隔毫秒数",
+                                              "ms", QString::number(config.flightCacheCheckMs));
+    QCommandLineOption maxPageSizeOption("max-page-size", "列表查询每页行数上限（0 不限）",
+                                         "count", QString::number(config.maxPageSize));
+    QCommandLineOption streamChunkOption("stream-chunk-rows", "流式回复每帧的行数",
+                                         "count", QString::number(config.streamChunkRows));
+    QCommandLineOption maxConnectionsOption("max-connections", "并发连接数上限（0 不限）",
+                                            "count", QString::number(config.maxConnections));
+    QCommandLineOption maxInFlightOption("max-in-flight", "在途请求数上限（0 不限）",
+                                         "count", QString::number(config.maxInFlightRequests));
+    QCommandLineOption maxQueuedOption("max-queued", "每个连接排队等待执行的顺序请求数上限",
+                                       "count", QString::number(config.maxQueuedRequests));
+    QCommandLineOption maxFrameOption("max-frame-size", "单帧最大字节数",
+                                      "bytes", QString::number(config.maxFrameSize));
+    QCommandLineOption highWaterOption("write-high-water", "待发送字节数高水位，超过后暂停读取",
+                                       "bytes", QString::number(config.writeHighWaterMark));
+    QCommandLineOption lowWaterOption("write-low-water", "待发送字节数低水位，低于后恢复读取",
+                                      "bytes", QString::number(config.writeLowWaterMark));
+    QCommandLineOption maxPendingOption("max-pending-write", "每个连接待发送字节数上限",
+                                        "bytes", QString::number(config.maxPendingWriteBytes));
+    QCommandLineOption heartbeatOption("heartbeat", "无数据多少毫秒后发送 ping（0 关闭）",
+                                       "ms", QString::number(config.heartbeatIntervalMs));
+    QCommandLineOption idleTimeoutOption("idle-timeout", "空闲多少毫秒后关闭连接（0 关闭）",
+                                         "ms", QString::number(config.idleTimeoutMs));
+    QCommandLineOption partialTimeoutOption("partial-frame-timeout", "未完成帧最长等待毫秒数（0 关闭）",
+                                            "ms", QString::number(config.partialFrameTimeoutMs));
+    QCommandLineOption sendBufferOption("send-buffer", "套接字发送缓冲区字节数（0 为系统默认）",
+                                        "bytes", QString::number(config.socketSendBufferSize));
+    QCommandLineOption recvBufferOption("recv-buffer", "套接字接收缓冲区字节数（0 为系统默认）",
+                                        "bytes", QString::number(config.socketReceiveBufferSize));
+    QCommandLineOption benchEncoderOption("bench-encoder", "不启动服务，用 rows 行航班比较两种回复编码路径后退出",
+                                          "rows");
+    QCommandLineOption benchFormatsOption("bench-formats", "不启动服务，比较 rows 行航班回复按 JSON 与 CBOR 编码的大小和耗时后退出",
+                                          "rows");
+    QCommandLineOption benchIterationsOption("bench-iterations", "--bench-encoder 与 --bench-formats 的重复次数",
+                                             "count", "200");
+    QCommandLineOption benchConnectionsOption("bench-connections",
+                                              "不启动服务，按 --io-backend 与 --io-threads 打开 count 个空闲连接，"
+                                              "报告内存与线程数后退出（仅 Linux）",
+                                              "count");
+    QCommandLineOption benchLoadOption("bench-load", "作为压测客户端连接 host:port 上已启动的服务端，"
+                                       "报告请求/秒与 p99 延迟后退出（仅 Linux）",
+                                       "host:port");
+    QCommandLineOption benchClientsOption("bench-clients", "--bench-load 的连接数", "count", "10000");
+    QCommandLineOption benchThreadsOption("bench-threads", "--bench-load 的客户端线程数（0 为 CPU 核数）",
+                                          "count", "0");
+    QCommandLineOption benchDurationOption("bench-duration", "--bench-load 的测量秒数（另有 2 秒预热）",
+                                           "seconds", "30");
+    QCommandLineOption benchRequestOption("bench-request", "--bench-load 发送的请求（JSON 对象），"
+                                          "默认 get_server_stats", "json");
+    parser.addOption(portOption);
+    parser.addOption(acceptorsOption);
+    parser.addOption(ioThreadsOption);
+    parser.addOption(backendOption);
+    parser.addOption(dbThreadsOption);
+    parser.addOption(dbPoolMinOption);
+    parser.addOption(dbPoolMaxOption);
+    parser.addOption(dbCheckoutTimeoutOption);
+    parser.addOption(schemaCheckOption);
+    parser.addOption(explainOption);
+    parser.addOption(warmupConnectionsOption);
+    parser.addOption(warmupQueriesOption);
+    parser.addOption(flightCacheOption);
+    parser.addOption(flightCacheCheckOption);
+    parser.addOption(maxPageSizeOption);
+    parser.addOption(streamChunkOption);
+    parser.addOption(maxConnectionsOption);
+    parser.addOption(maxInFlightOption);
+    parser.addOption(maxQueuedOption);
+    parser.addOption(maxFrameOption);
+    parser.addOption(highWaterOption);
+    parser.addOption(lowWaterOption);
+    parser.addOption(maxPendingOption);
+    parser.addOption(heartbeatOption);
+    parser.addOption(idleTimeoutOption);
+    parser.addOption(partialTimeoutOption);
+    parser.addOption(sendBufferOption);
+    parser.addOption(recvBufferOption);
+    parser.addOption(benchEncoderOption);
+    parser.addOption(benchFormatsOption);
+    parser.addOption(benchIterationsOption);
+    parser.addOption(benchConnectionsOption);
+    parser.addOption(benchLoadOption);
+    parser.addOption(benchClientsOption);
+    parser.addOption(benchThreadsOption);
+    parser.addOption(benchDurationOption);
+    parser.addOption(benchRequestOption);
+    parser.process(a);
+
+    if (parser.isSet(benchEncoderOption))
+        return EncoderBench::run(parser.value(benchEncoderOption).toInt(),
+                                 parser.value(benchIterationsOption).toInt());
+    if (parser.isSet(benchFormatsOption))
+        return EncoderBench::runFormats(parser.value(benchFormatsOption).toInt(),
+                                        parser.value(benchIterationsOption).toInt());
+    if (parser.isSet(benchLoadOption)) {
+        LoadBench::Options load;
+        const QString target = parser.value(benchLoadOption);
+        const int colon = target.lastIndexOf(':');
+        load.host = colon > 0 ? target.left(colon) : QString("127.0.0.1");
+        load.port = (colon >= 0 ? target.mid(colon + 1) : target).toUShort();
+        load.connections = parser.value(benchClientsOption).toInt();
+        load.threads = parser.value(benchThreadsOption).toInt();
+        load.durationSec = parser.value(benchDurationOption).toInt();
+        if (parser.isSet(benchRequestOption)) {
+            load.request = QJsonDocument::fromJson(parser.value(benchRequestOption).toUtf8()).object();
+            if (load.request.isEmpty()) {
+                qCritical() << "--bench-request 不是有效的 JSON 对象";
+                return 1;
+            }
+        }
+        if (load.port == 0) {
+            qCritical() << "--bench-load 需要 host:port";
+            return 1;
+        }
+        return LoadBench::run(load);
+    }
+
+    config.port = parser.value(portOption).toUShort();
+    config.acceptorThreads = parser.value(acceptorsOption).toInt();
+    config.ioThreads = parser.value(ioThreadsOption).toInt();
+    config.dbThreads = parser.value(dbThreadsOption).toInt();
+
+    const QString backend = parser.value(backendOption);
+    if (backend == "epoll") {
+        config.ioBackend = ServerConfig::IoBackend::Epoll;
+    } else if (backend != "qt") {
+        qCritical() << "未知的 I/O 后端：" << backend;
+        return 1;
+    }
+
+    config.dbPoolMin = parser.value(dbPoolMinOption).toInt();
+    config.dbPoolMax = parser.value(dbPoolMaxOption).toInt();
+    config.dbCheckoutTimeoutMs = parser.value(dbCheckoutTimeoutOption).toInt();
+
+    const QString schemaCheck = parser.value(schemaCheckOption);
+    if (schemaCheck == "verify") {
+        config.schemaCheck = ServerConfig::SchemaCheck::Verify;
+    } else if (schemaCheck == "off") {
+        config.schemaCheck = ServerConfig::SchemaCheck::Off;
+    } else if (schemaCheck != "migrate") {
+        qCritical() << "未知的表结构检查方式：" << schemaCheck;
+        return 1;
+    }
+    config.explainStatements = parser.isSet(explainOption);
+    config.warmupConnections = parser.value(warmupConnectionsOption).toInt();
+    config.warmupQueriesFile = parser.value(warmupQueriesOption);
+
+    config.flightCacheEntries = parser.value(flightCacheOption).toInt();
+    config.flightCacheCheckMs = parser.value(flightCacheCheckOption).toInt();
+    config.maxPageSize = parser.value(maxPageSizeOption).toInt();
+    config.streamChunkRows = parser.value(streamChunkOption).toInt();
+    config.maxConnections = parser.value(maxConnectionsOption).toInt();
+    config.maxInFlightRequests = parser.value(maxInFlightOption).toInt();
+    config.maxQueuedRequests = parser.value(maxQueuedOption).toInt();
+    config.maxFrameSize = parser.value(maxFrameOption).toUInt();
+    config.writeHighWaterMark = parser.value(highWaterOption).toLongLong();
+    config.writeLowWaterMark = parser.value(lowWaterOption).toLongLong();
+    config.maxPendingWriteBytes = parser.value(maxPendingOption).toLongLong();
+    config.heartbeatIntervalMs = parser.value(heartbeatOption).toLongLong();
+    config.idleTimeoutMs = parser.value(idleTimeoutOption).toLongLong();
+    config.partialFrameTimeoutMs = parser.value(partialTimeoutOption).toLongLong();
+    config.socketSendBufferSize = parser.value(sendBufferOption).toInt();
+    config.socketReceiveBufferSize = parser.value(recvBufferOption).toInt();
+
+    if (parser.isSet(benchConnectionsOption))
+        return ConnectionBench::run(config, parser.value(benchConnectionsOption).toInt());
+
+    TcpServer server(config);
+    if (config.explainStatements)
+        return server.explainStatements() > 0 ? 1 : 0;
+    if (!server.startServer(config.port)) {
         return 1;
     }
 